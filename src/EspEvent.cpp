@@ -1,28 +1,120 @@
 #include "EspEvent.h"
+#include <new>
 
-EspEvent::EspEvent() : _time_ms(0), _HANDLE("null") {}
+EspEvent::EspEvent()
+	: _HANDLE("null"), _time_ms(0), _kind(KIND_NONE), _sheddable(false),
+	  _priority(0), _callbackId(EspEventRegistry::INVALID_ID),
+	  _context{nullptr, nullptr} {}
 
 EspEvent::EspEvent(unsigned long relative_time_ms, callback_t event,
 				   const char *identifying_handle)
-	: _time_ms(relative_time_ms), _callback(event),
-	  _HANDLE(identifying_handle) {}
+	: _HANDLE(identifying_handle), _time_ms(relative_time_ms),
+	  _kind(KIND_NONE), _sheddable(false), _priority(0),
+	  _callbackId(EspEventRegistry::INVALID_ID), _context{nullptr, nullptr} {
+	setCallback(event);
+}
 
-EspEvent::operator bool() const { return (bool)_callback; }
-unsigned long EspEvent::getTime() const { return _time_ms; }
-const char *EspEvent::getHandle() const { return _HANDLE; }
+EspEvent::EspEvent(unsigned long relative_time_ms,
+				   EspEventRegistry::id_t callback_id, uint32_t arg,
+				   const char *identifying_handle)
+	: _HANDLE(identifying_handle), _time_ms(relative_time_ms),
+	  _kind(KIND_NONE), _sheddable(false), _priority(0),
+	  _callbackId(EspEventRegistry::INVALID_ID), _context{nullptr, nullptr} {
+	if (EspEventRegistry::contains(callback_id)) {
+		_kind = KIND_REGISTRY;
+		_callbackId = callback_id;
+		_arg = arg;
+	}
+}
+
+EspEvent::EspEvent(unsigned long relative_time_ms, context_callback_t callback,
+				   void *payload, const char *identifying_handle)
+	: _HANDLE(identifying_handle), _time_ms(relative_time_ms),
+	  _kind(KIND_NONE), _sheddable(false), _priority(0),
+	  _callbackId(EspEventRegistry::INVALID_ID), _context{callback, payload} {
+	if (callback) _kind = KIND_CONTEXT;
+}
 
-void EspEvent::runEvent() const {
-	if (_callback) {
-		(_callback)();
+EspEvent::EspEvent(const EspEvent &other)
+	: _HANDLE(other._HANDLE), _time_ms(other._time_ms), _kind(KIND_NONE),
+	  _sheddable(other._sheddable), _priority(other._priority),
+	  _callbackId(EspEventRegistry::INVALID_ID), _context{nullptr, nullptr} {
+	copyCallback(other);
+}
+
+EspEvent::EspEvent(EspEvent &&other)
+	: _HANDLE(other._HANDLE), _time_ms(other._time_ms), _kind(KIND_NONE),
+	  _sheddable(other._sheddable), _priority(other._priority),
+	  _callbackId(EspEventRegistry::INVALID_ID), _context{nullptr, nullptr} {
+	moveCallback(other);
+}
+
+EspEvent &EspEvent::operator=(const EspEvent &other) {
+	if (this != &other) {
+		release();
+		_HANDLE = other._HANDLE;
+		_time_ms = other._time_ms;
+		_sheddable = other._sheddable;
+		_priority = other._priority;
+		copyCallback(other);
 	}
+	return *this;
 }
 
+EspEvent &EspEvent::operator=(EspEvent &&other) {
+	if (this != &other) {
+		release();
+		_HANDLE = other._HANDLE;
+		_time_ms = other._time_ms;
+		_sheddable = other._sheddable;
+		_priority = other._priority;
+		moveCallback(other);
+	}
+	return *this;
+}
+
+EspEvent::~EspEvent() { release(); }
+
+EspEvent::operator bool() const { return _kind != KIND_NONE; }
+unsigned long EspEvent::getTime() const { return _time_ms; }
+const char *EspEvent::getHandle() const { return _HANDLE; }
+
 EspEvent &EspEvent::setTime(unsigned long ms) {
 	_time_ms = ms;
 	return *this;
 }
 
 EspEvent &EspEvent::setCallback(const callback_t &callback) {
-	_callback = callback;
+	release();
+	if (callback) {
+		new (&_callback) callback_t(callback);
+		_kind = KIND_FUNCTION;
+	}
 	return *this;
-}
\ No newline at end of file
+}
+
+void EspEvent::release() {
+	if (_kind == KIND_FUNCTION) _callback.~callback_t();
+	_kind = KIND_NONE;
+	_callbackId = EspEventRegistry::INVALID_ID;
+	_context = {nullptr, nullptr};
+}
+
+void EspEvent::copyCallback(const EspEvent &other) {
+	_kind = other._kind;
+	_callbackId = other._callbackId;
+	if (_kind == KIND_FUNCTION)
+		new (&_callback) callback_t(other._callback);
+	else
+		_context = other._context;
+}
+
+void EspEvent::moveCallback(EspEvent &other) {
+	_kind = other._kind;
+	_callbackId = other._callbackId;
+	if (_kind == KIND_FUNCTION)
+		new (&_callback) callback_t(std::move(other._callback));
+	else
+		_context = other._context;
+	other.release();
+}
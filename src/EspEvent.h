@@ -17,22 +17,53 @@
 #include <vector>
 #include <functional>
 #include <algorithm>
+#include "EspEventContext.h"
+#include "EspEventRegistry.h"
 
 /**
  *
  * Data structure representing one event. Holds data about the callback method
  * to run and the tick delay relative to the preceeding event
  *
+ * Events that reference EspEventRegistry store only an id and an argument.
+ * Context events store their function and payload. These share their storage
+ * with the std::function of function events, which is held inline as it
+ * always was, so small lambdas are still stored without allocating
+ *
  */
 class EspEvent {
 
   public:
 	typedef std::function<void()> callback_t;
+	typedef void (*context_callback_t)(EspEventContext &context);
 
   private:
+	struct context_event_t {
+		context_callback_t callback;
+		void *payload;
+	};
+
+	enum kind_t : uint8_t {
+		KIND_NONE,
+		KIND_FUNCTION,
+		KIND_REGISTRY,
+		KIND_CONTEXT
+	};
+
 	const char *_HANDLE;
-	unsigned long _time_ms;
-	callback_t _callback;
+	uint32_t _time_ms;
+	uint8_t _kind : 7;
+	uint8_t _sheddable : 1;
+	uint8_t _priority;
+	// Registry id
+	EspEventRegistry::id_t _callbackId;
+	// Only the member picked by _kind is alive, _callback is built and
+	// destroyed by hand
+	union {
+		uint32_t _arg;
+		context_event_t _context;
+		callback_t _callback;
+	};
 
   public:
 	/**
@@ -58,6 +89,50 @@ class EspEvent {
 	EspEvent(unsigned long relative_time_ms, callback_t event,
 			 const char *identifying_handle = "null");
 
+	/**
+	 * @brief Constructor for an event that runs a callback from
+	 * EspEventRegistry
+	 *
+	 * @param relative_time_ms      The delay in milliseconds between the
+	 * preceeding event and this event 0 < relative_time_ms
+	 *
+	 * @param callback_id           The id of a registered callback,
+	 * EspEventRegistry::contains(callback_id)
+	 *
+	 * @param arg                   The argument passed to the callback
+	 *
+	 * @param identifying_handle    A text handle to identify this event as part
+	 * of the chain
+	 */
+	EspEvent(unsigned long relative_time_ms,
+			 EspEventRegistry::id_t callback_id, uint32_t arg = 0,
+			 const char *identifying_handle = "null");
+
+	/**
+	 * @brief Constructor for an event whose callback receives an
+	 * EspEventContext describing the event
+	 *
+	 * @param relative_time_ms      The delay in milliseconds between the
+	 * preceeding event and this event 0 < relative_time_ms
+	 *
+	 * @param callback              The function to run, callback != null
+	 *
+	 * @param payload               Pointer handed to the callback through
+	 * EspEventContext::getPayload(), not owned by the event
+	 *
+	 * @param identifying_handle    A text handle to identify this event as part
+	 * of the chain
+	 */
+	EspEvent(unsigned long relative_time_ms, context_callback_t callback,
+			 void *payload = nullptr,
+			 const char *identifying_handle = "null");
+
+	EspEvent(const EspEvent &other);
+	EspEvent(EspEvent &&other);
+	EspEvent &operator=(const EspEvent &other);
+	EspEvent &operator=(EspEvent &&other);
+	~EspEvent();
+
 	/**
 	 * @brief Tests whether the event stores a callable function
 	 *
@@ -94,6 +169,45 @@ class EspEvent {
 	 */
 	unsigned long getTime() const;
 
+	/**
+	 * @brief Sets the priority of this event. When events of several chains
+	 * on one dispatcher are due at the same time, the highest priority runs
+	 * first
+	 *
+	 * @param priority	0 by default, higher runs first
+	 *
+	 * @return this
+	 */
+	EspEvent &setPriority(uint8_t priority) {
+		_priority = priority;
+		return *this;
+	}
+
+	/**
+	 * @brief Gets the priority of this event
+	 *
+	 * @return The value given to setPriority(), 0 by default
+	 */
+	uint8_t getPriority() const { return _priority; }
+
+	/**
+	 * @brief Marks this event as one that may be dropped when its dispatcher
+	 * falls behind. See EspEventDispatcher::setShedThreshold()
+	 *
+	 * @param sheddable	false by default
+	 *
+	 * @return this
+	 */
+	EspEvent &setSheddable(bool sheddable) {
+		_sheddable = sheddable;
+		return *this;
+	}
+
+	/**
+	 * @brief Gets whether this event may be dropped under load
+	 */
+	bool isSheddable() const { return _sheddable; }
+
 	/**
 	 * @brief Gets the text handle for this event for the purpose of
 	 * identification
@@ -103,11 +217,81 @@ class EspEvent {
 	 */
 	const char *getHandle() const;
 
+	/**
+	 * @brief Gets the id of the registered callback run by this event
+	 *
+	 * @return EspEventRegistry::INVALID_ID if the event does not reference the
+	 * registry, otherwise the id assigned at construction
+	 */
+	EspEventRegistry::id_t getCallbackId() const {
+		return _kind == KIND_REGISTRY ? _callbackId
+									  : EspEventRegistry::INVALID_ID;
+	}
+
+	/**
+	 * @brief Gets the argument passed to the registered callback
+	 *
+	 * @return The argument assigned at construction, 0 by default
+	 */
+	uint32_t getArg() const { return _kind == KIND_REGISTRY ? _arg : 0; }
+
+	/**
+	 * @brief Gets the payload handed to a context callback
+	 *
+	 * @return nullptr if the event does not have a context callback
+	 */
+	void *getPayload() const {
+		return _kind == KIND_CONTEXT ? _context.payload : nullptr;
+	}
+
+	/**
+	 * @brief Runs the callback for this event outside of a chain
+	 *
+	 */
+	void runEvent() const {
+		EspEventContext context;
+		runEvent(context);
+	}
+
 	/**
 	 * @brief Runs the callback for this event
 	 *
+	 * @param context	Scheduling information for context callbacks, ignored
+	 * by other kinds of callback
+	 *
+	 */
+	void runEvent(EspEventContext &context) const {
+		if (_kind == KIND_REGISTRY) {
+			EspEventRegistry::call(_callbackId, _arg);
+		} else if (_kind == KIND_CONTEXT) {
+			context._payload = _context.payload;
+			_context.callback(context);
+		} else if (_kind == KIND_FUNCTION) {
+			_callback();
+		}
+	}
+
+  private:
+	/**
+	 * @brief Destroys the std::function callback, if any
+	 *
+	 * post: _kind == KIND_NONE
+	 */
+	void release();
+
+	/**
+	 * @brief Copies the callback of another event into this one
+	 *
+	 * pre: _kind == KIND_NONE
+	 */
+	void copyCallback(const EspEvent &other);
+
+	/**
+	 * @brief Takes the callback of another event, leaving it empty
+	 *
+	 * pre: _kind == KIND_NONE
 	 */
-	void runEvent() const;
+	void moveCallback(EspEvent &other);
 };
 
 #endif
\ No newline at end of file
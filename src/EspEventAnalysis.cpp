@@ -0,0 +1,222 @@
+#include "EspEventAnalysis.h"
+#include "EspEventChain.h"
+#include "EspEventTrace.h"
+
+EspEventAnalysis::EspEventAnalysis() : _utilization(0), _feasible(true) {}
+
+void EspEventAnalysis::add(const EspEventChain &chain) {
+	if (chain.getCycleTime() == 0) {
+		__ESP_EVENT_LOGW__("Not analyzing chain because all times are zero");
+		return;
+	}
+	for (const chain_t &added : _chains) {
+		if (added.chain == &chain) return;
+	}
+
+	chain_t entry;
+	entry.chain = &chain;
+	entry.period_us = (uint64_t)chain.getCycleTime() * 1000;
+	entry.cost_us = 0;
+	entry.first = _steps.size();
+
+	// Events after the first share a step with the one before when their
+	// time is zero, since they run back to back. Events the chain skips for
+	// want of a callback are left out
+	const std::vector<unsigned long> &offsets = chain.getOffsets();
+	for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+		if (pos && !chain.callableAt(pos)) continue;
+		const uint64_t cost_us = chain.getCostOf(pos);
+		const uint64_t offset_us = (uint64_t)offsets[pos] * 1000;
+		entry.cost_us += cost_us;
+		if (pos && _steps.back().offset_us == offset_us) {
+			_steps.back().cost_us += cost_us;
+			continue;
+		}
+		_steps.push_back({&chain, pos, offset_us, cost_us, 0, 0});
+	}
+	entry.last = _steps.size();
+
+	for (size_t i = entry.first; i < entry.last; i++) {
+		const uint64_t next_us =
+			i + 1 < entry.last ? _steps[i + 1].offset_us : entry.period_us;
+		_steps[i].deadline_us = next_us - _steps[i].offset_us;
+	}
+	_chains.push_back(entry);
+}
+
+void EspEventAnalysis::clear() {
+	_chains.clear();
+	_steps.clear();
+	_utilization = 0;
+	_feasible = true;
+}
+
+bool EspEventAnalysis::checkBound() {
+	_utilization = utilization();
+	if (_utilization >= 1.0f) return false;
+
+	uint64_t cycles_us = 0;
+	for (const chain_t &chain : _chains) cycles_us += chain.cost_us;
+	for (const step_t &step : _steps) {
+		if (cycles_us > step.deadline_us) return false;
+	}
+	return true;
+}
+
+bool EspEventAnalysis::analyze() {
+	_utilization = utilization();
+
+	// Every backlog is cleared within the longest busy period
+	const uint64_t busy_us = _utilization < 1.0f ? busyPeriod() : UNBOUNDED;
+	_feasible = true;
+	for (size_t owner = 0; owner < _chains.size(); owner++) {
+		const chain_t &chain = _chains[owner];
+		for (size_t i = chain.first; i < chain.last; i++) {
+			step_t &step = _steps[i];
+			step.response_us = busy_us != UNBOUNDED
+									   ? responseOf(i, owner, busy_us)
+									   : UNBOUNDED;
+			if (step.response_us > step.deadline_us) _feasible = false;
+		}
+	}
+
+	__ESP_EVENT_LOGD__("Analyzed %i chains, utilization %f, %s",
+					   _chains.size(), _utilization,
+					   _feasible ? "feasible" : "infeasible");
+	return _feasible;
+}
+
+uint64_t EspEventAnalysis::getWorstResponse(const EspEventChain &chain) const {
+	for (const chain_t &entry : _chains) {
+		if (entry.chain != &chain) continue;
+		uint64_t worst = 0;
+		for (size_t i = entry.first; i < entry.last; i++) {
+			if (_steps[i].response_us > worst) worst = _steps[i].response_us;
+		}
+		return worst;
+	}
+	return 0;
+}
+
+size_t EspEventAnalysis::loadCosts(EspEventChain &chain,
+								   const EspEventTrace &trace) {
+	std::vector<uint32_t> longest(chain.numEvents(), 0);
+	std::vector<bool> seen(chain.numEvents(), false);
+	for (size_t i = 0; i < trace.size(); i++) {
+		const EspEventTraceRecord &record = trace.get(i);
+		if (record.chain_id != chain.getId()) continue;
+		if (record.index >= chain.numEvents()) continue;
+		const uint32_t duration_us = record.end_us - record.start_us;
+		if (duration_us > longest[record.index])
+			longest[record.index] = duration_us;
+		seen[record.index] = true;
+	}
+
+	size_t loaded = 0;
+	for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+		if (!seen[pos]) continue;
+		chain.setCostOf(pos, longest[pos]);
+		loaded++;
+	}
+	return loaded;
+}
+
+/*
+ *
+ * 	Private methods
+ *
+ */
+
+float EspEventAnalysis::utilization() const {
+	float utilization = 0;
+	for (const chain_t &chain : _chains) {
+		utilization += (float)chain.cost_us / chain.period_us;
+	}
+	return utilization;
+}
+
+uint64_t EspEventAnalysis::demand(const chain_t &chain,
+								  uint64_t window_us) const {
+	// Whole cycles bring every step due, the rest of the window brings the
+	// most costly run of consecutive steps that fits in it
+	const uint64_t rest_us = window_us % chain.period_us;
+	uint64_t partial = 0;
+	for (size_t first = chain.first; first < chain.last; first++) {
+		uint64_t sum = 0;
+		for (size_t i = chain.first; i < chain.last; i++) {
+			const uint64_t distance_us =
+				(_steps[i].offset_us + chain.period_us -
+				 _steps[first].offset_us) %
+				chain.period_us;
+			if (distance_us <= rest_us) sum += _steps[i].cost_us;
+		}
+		if (sum > partial) partial = sum;
+	}
+	return window_us / chain.period_us * chain.cost_us + partial;
+}
+
+uint64_t EspEventAnalysis::demandBefore(const chain_t &chain, size_t step,
+										uint64_t window_us) const {
+	const uint64_t rest_us = window_us % chain.period_us;
+	uint64_t partial = 0;
+	for (size_t i = chain.first; i < chain.last; i++) {
+		const uint64_t distance_us = (_steps[step].offset_us +
+									  chain.period_us - _steps[i].offset_us) %
+									 chain.period_us;
+		if (distance_us <= rest_us) partial += _steps[i].cost_us;
+	}
+	return window_us / chain.period_us * chain.cost_us + partial;
+}
+
+uint64_t EspEventAnalysis::busyPeriod() const {
+	// Converges when utilization is below one, the limit only guards
+	// against rounding
+	uint64_t longest_period = 0;
+	uint64_t busy_us = 0;
+	for (const chain_t &chain : _chains) {
+		if (chain.period_us > longest_period) longest_period = chain.period_us;
+		busy_us += demand(chain, 0);
+	}
+	const uint64_t limit = longest_period * 1000;
+	for (;;) {
+		uint64_t next = 0;
+		for (const chain_t &chain : _chains) next += demand(chain, busy_us);
+		if (next == busy_us) return busy_us;
+		if (next > limit) return UNBOUNDED;
+		busy_us = next;
+	}
+}
+
+uint64_t EspEventAnalysis::responseOf(size_t step, size_t owner,
+									  uint64_t busy_us) const {
+	// Events run in order of due time without preemption, so the step
+	// completes once the work that came due no later than it is done
+	// The backlog can only grow where a step comes due, which is a whole
+	// number of cycles plus the distance between two steps of a chain
+	uint64_t response_us = 0;
+	for (size_t k = 0; k < _chains.size(); k++) {
+		const chain_t &chain = _chains[k];
+		for (size_t i = chain.first; i < chain.last; i++) {
+			for (size_t j = chain.first; j < chain.last; j++) {
+				if (k == owner && j != step) continue;
+				const uint64_t distance_us =
+					(_steps[j].offset_us + chain.period_us -
+					 _steps[i].offset_us) %
+					chain.period_us;
+				for (uint64_t window_us = distance_us; window_us <= busy_us;
+					 window_us += chain.period_us) {
+					uint64_t work_us = demandBefore(_chains[owner], step,
+													window_us);
+					for (size_t other = 0; other < _chains.size(); other++) {
+						if (other == owner) continue;
+						work_us += demand(_chains[other], window_us);
+					}
+					if (work_us > window_us &&
+						work_us - window_us > response_us)
+						response_us = work_us - window_us;
+				}
+			}
+		}
+	}
+	return response_us;
+}
@@ -0,0 +1,205 @@
+/**
+ * @file EspEventAnalysis.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Checks ahead of time whether a set of chains can meet their deadlines on
+ * one EspEventDispatcher, given the cost of each event
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_ANALYSIS_H__
+#define __ESP_EVENT_ANALYSIS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class EspEventChain;
+class EspEventTrace;
+
+/**
+ *
+ * Response time analysis for the dispatcher, which runs one event at a time
+ * in order of due time and never preempts a callback. Each chain repeats
+ * every getCycleTime(), and the events of a chain due at the same offset
+ * run back to back as one step. A step meets its deadline if it completes
+ * before the next step of its chain is due
+ *
+ * A step waits for the work that came due no later than it and is not yet
+ * done. The worst-case response takes the most work the other chains can
+ * bring due in any window, whatever their phase, so it is safe but may be
+ * pessimistic for chains started in step. Events waiting for a signal are
+ * taken to come due at their timeout, and costs come from
+ * EspEventChain::getCostOf(). Every event is taken to run: events the
+ * dispatcher would shed and events skipped or stopped by an overrun policy
+ * are still counted, so those policies only make the bound looser
+ *
+ * analyze() compares every pair of steps over each window in the busy
+ * period, so its time grows faster than the cube of numSteps(). checkBound()
+ * is a looser test that takes time linear in numSteps()
+ *
+ * 		EspEventAnalysis analysis;
+ * 		analysis.add(motor);
+ * 		analysis.add(telemetry);
+ * 		if (!analysis.analyze())
+ * 			Serial.printf("Utilization %f\n", analysis.getUtilization());
+ *
+ */
+class EspEventAnalysis {
+
+  public:
+	// Response of steps that may wait forever
+	static const uint64_t UNBOUNDED = ~(uint64_t)0;
+
+	struct step_t {
+		const EspEventChain *chain;
+		size_t index;		  // First event of the step
+		uint64_t offset_us;   // Time from the start of the chain's cycle
+		uint64_t cost_us;	 // Sum of the costs of the step's events
+		uint64_t deadline_us; // Time until the next step of the chain
+		uint64_t response_us; // Worst-case time from due to completion
+	};
+
+  private:
+	struct chain_t {
+		const EspEventChain *chain;
+		uint64_t period_us;
+		uint64_t cost_us;
+		size_t first, last; // Range of the chain's steps in _steps
+	};
+
+	std::vector<chain_t> _chains;
+	std::vector<step_t> _steps;
+	float _utilization;
+	bool _feasible;
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: numSteps() == 0, isFeasible() == true
+	 */
+	EspEventAnalysis();
+
+	/**
+	 * @brief Adds a chain to the set. Chains without time are left out, as
+	 * they cannot be started
+	 *
+	 * @param chain	Must outlive the analysis
+	 */
+	void add(const EspEventChain &chain);
+
+	/**
+	 * @brief Removes every chain
+	 */
+	void clear();
+
+	/**
+	 * @brief Computes the utilization and the worst-case response of every
+	 * step
+	 *
+	 * @return true if every step completes before its deadline
+	 */
+	bool analyze();
+
+	/**
+	 * @brief Computes the utilization, and whether every step would meet
+	 * its deadline even behind one whole cycle of every chain. No chain
+	 * brings more work due in a window than its utilization times the
+	 * window plus one cycle, so below full utilization that is the longest
+	 * any step waits. Does not compute the response of each step
+	 *
+	 * @return true if analyze() would find the set feasible. false means
+	 * analyze() is needed to tell, unless getUtilization() >= 1, where the
+	 * set is infeasible
+	 */
+	bool checkBound();
+
+	/**
+	 * @brief Gets the fraction of time spent in callbacks
+	 *
+	 * @return Sum over chains of cost per cycle over cycle length, above 1
+	 * if the set cannot keep up
+	 */
+	float getUtilization() const { return _utilization; }
+
+	/**
+	 * @brief Gets whether the last analyze() found every deadline met
+	 */
+	bool isFeasible() const { return _feasible; }
+
+	/**
+	 * @brief Gets the number of steps analyzed
+	 */
+	size_t numSteps() const { return _steps.size(); }
+
+	/**
+	 * @brief Gets a step, with its response filled in by analyze()
+	 *
+	 * @param pos	0 <= pos < numSteps()
+	 */
+	const step_t &getStep(size_t pos) const { return _steps[pos]; }
+
+	/**
+	 * @brief Gets the worst response of any step of a chain
+	 *
+	 * @return Time in microseconds, UNBOUNDED if it may never run, 0 if the
+	 * chain was not analyzed
+	 */
+	uint64_t getWorstResponse(const EspEventChain &chain) const;
+
+	/**
+	 * @brief Sets the cost of each event of a chain to the longest run of
+	 * that event recorded in a trace, so measured costs can be analyzed
+	 * when none were declared
+	 *
+	 * @param chain	The chain, matched to records by getId()
+	 *
+	 * @return The number of events given a cost
+	 */
+	static size_t loadCosts(EspEventChain &chain, const EspEventTrace &trace);
+
+  private:
+	/**
+	 * @brief Sums cost per cycle over cycle length for every chain
+	 */
+	float utilization() const;
+
+	/**
+	 * @brief Gets the most work a chain can bring due in any window
+	 *
+	 * @param window_us	Length of the window, the ends included
+	 */
+	uint64_t demand(const chain_t &chain, uint64_t window_us) const;
+
+	/**
+	 * @brief Gets the most work of a chain that can be due in a window
+	 * ending with one of its steps
+	 *
+	 * @param step	Position of the last step in _steps
+	 */
+	uint64_t demandBefore(const chain_t &chain, size_t step,
+						  uint64_t window_us) const;
+
+	/**
+	 * @brief Gets the longest time the dispatcher can be kept busy
+	 *
+	 * @return Time in microseconds, UNBOUNDED if it may never be idle
+	 */
+	uint64_t busyPeriod() const;
+
+	/**
+	 * @brief Computes the worst-case response of a step
+	 *
+	 * @param step		Position of the step in _steps
+	 * @param owner		Position of its chain in _chains
+	 * @param busy_us	busyPeriod()
+	 */
+	uint64_t responseOf(size_t step, size_t owner, uint64_t busy_us) const;
+};
+
+#endif
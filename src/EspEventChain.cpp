@@ -1,16 +1,63 @@
 #include "EspEventChain.h"
 
+std::atomic<uint32_t> EspEventChain::sGlobalTimeScale(TIME_SCALE_ONE);
+
 /**
  *
  *
  * 	Constructors
  *
  */
-EspEventChain::EspEventChain() { construct(); }
+EspEventChain::EspEventChain() : _pattern(std::make_shared<pattern_t>()) {
+	construct();
+}
+
+EspEventChain::EspEventChain(size_t num_events)
+	: _pattern(std::make_shared<pattern_t>()) {
+	_pattern->events.reserve(num_events);
+	construct();
+}
+
+EspEventChain::EspEventChain(const EspEventTable &table)
+	: _pattern(std::make_shared<pattern_t>()), _table(table) {
+	__ESP_EVENT_LOGI__("Constructing chain from table with %i events",
+					   table.numEvents());
+	construct();
+	_fromTable = true;
+}
 
-EspEventChain::EspEventChain(size_t num_events) {
-	_events.reserve(num_events);
+EspEventChain::EspEventChain(const EspEventChain &other)
+	: _pattern(other.sharePattern()), _table(other._table) {
 	construct();
+	_timeScale = other._timeScale.load();
+	_overrunHook = other._overrunHook;
+	_overrunPolicy = other._overrunPolicy;
+	_completionHook = other._completionHook;
+	_completionArg = other._completionArg;
+	_completionSignal = other._completionSignal;
+	_fromTable = other._fromTable;
+}
+
+EspEventChain &EspEventChain::operator=(const EspEventChain &other) {
+	if (this != &other) {
+		stop();
+		_pattern = other.sharePattern();
+		_table = other._table;
+		_timeScale = other._timeScale.load();
+		_overrunHook = other._overrunHook;
+		_overrunPolicy = other._overrunPolicy;
+		_completionHook = other._completionHook;
+		_completionArg = other._completionArg;
+		_completionSignal = other._completionSignal;
+		_fromTable = other._fromTable;
+		_currentEvent = 0;
+	}
+	return *this;
+}
+
+EspEventChain::~EspEventChain() {
+	stop();
+	if (_dispatcher) _dispatcher->remove(*this);
 }
 
 /**
@@ -25,58 +72,118 @@ unsigned long EspEventChain::getTotalTime() const {
 	return getTotalTimeBefore(numEvents() - 1) + getTimeOf(numEvents() - 1);
 }
 
+unsigned long EspEventChain::getCycleTime() const {
+	return getOffsets().back();
+}
+
+unsigned long EspEventChain::getCurrentOffset() const {
+	if (!_started && !_paused) return 0;
+
+	// The pending event is due at its own offset, or at the end of the cycle
+	// if the chain has wrapped around
+	const std::vector<unsigned long> &offsets = getOffsets();
+	const unsigned long cycle = offsets.back();
+	const unsigned long due =
+		_currentEvent == 0 ? cycle : offsets[_currentEvent];
+	// Time left is in scaled time, offsets are not
+	const unsigned long left = unscaleTime(getTimeUntilNextEvent());
+	return (due + cycle - left % cycle) % cycle;
+}
+
+unsigned long EspEventChain::getTimeUntilNextEvent() const {
+	if (_paused) return _remaining;
+	if (!_started) return 0;
+	const unsigned long now = EspEventClock::now();
+	return (long)(_deadline - now) > 0 ? _deadline - now : 0;
+}
+
 unsigned long EspEventChain::getTotalTimeBefore(size_t event_num) const {
 	if (event_num == 0) {
 		return 0;
 	}
 
-	__ESP_EVENT_CHAIN_CHECK_POS__(event_num);
+	__ESP_EVENT_CHAIN_CHECK_END__(event_num, 0);
 
-	// Iterate through list, adding up getTimeOf()
+	// Checked once above, so the loop reads the times directly
 	unsigned long total = 0;
-	for (int pos = 0; pos < event_num; pos++) {
-		total += getTimeOf(pos);
+	for (size_t pos = 0; pos < event_num; pos++) {
+		total += timeAt(pos);
 	}
 
 	return total;
 }
 
 unsigned long EspEventChain::getTimeOf(size_t event_num) const {
-	__ESP_EVENT_CHAIN_CHECK_POS__(event_num);
-	return _events.at(event_num).getTime();
+	__ESP_EVENT_CHAIN_CHECK_POS__(event_num, 0);
+	return timeAt(event_num);
+}
+
+EspEvent EspEventChain::getEvent(size_t event_num) const {
+	__ESP_EVENT_CHAIN_CHECK_POS__(event_num, EspEvent());
+	return _fromTable ? _table.getEvent(event_num)
+					  : _pattern->events[event_num];
+}
+
+void EspEventChain::setCostOf(size_t event_num, unsigned long cost_us) {
+	__ESP_EVENT_CHAIN_CHECK_POS__(event_num, );
+	unshareEvents();
+	std::vector<uint32_t> &costs = _pattern->costs;
+	if (costs.size() != numEvents()) costs.resize(numEvents(), 0);
+	costs[event_num] = cost_us;
+}
+
+unsigned long EspEventChain::getCostOf(size_t event_num) const {
+	__ESP_EVENT_CHAIN_CHECK_POS__(event_num, 0);
+	const std::vector<uint32_t> &costs = _pattern->costs;
+	return event_num < costs.size() ? costs[event_num] : 0;
+}
+
+void EspEventChain::setSignalOf(size_t event_num, const char *signal) {
+	__ESP_EVENT_CHAIN_CHECK_POS__(event_num, );
+	unshareEvents();
+	std::vector<const char *> &signals = _pattern->signals;
+	if (signals.size() != numEvents()) signals.resize(numEvents(), nullptr);
+	signals[event_num] = signal;
+}
+
+const char *EspEventChain::getSignalOf(size_t event_num) const {
+	__ESP_EVENT_CHAIN_CHECK_POS__(event_num, nullptr);
+	return signalAt(event_num);
 }
 
 int EspEventChain::getPositionFromHandle(const char *handle) const {
-	__ESP_EVENT_CHAIN_CHECK_PTR__(handle);
+	__ESP_EVENT_CHAIN_CHECK_PTR__(handle, -1);
+	if (_fromTable) return _table.getPositionFromHandle(handle);
 
 	citerator_t target_pos = getIteratorFromHandle(handle);
-	if (target_pos != _events.cend())
-		return std::distance(_events.cbegin(), target_pos);
+	if (target_pos != _pattern->events.cend())
+		return std::distance(_pattern->events.cbegin(), target_pos);
 	else
 		return -1;
 }
 
 EspEventChain::citerator_t
 EspEventChain::getIteratorFromHandle(const char *handle) const {
-	__ESP_EVENT_CHAIN_CHECK_PTR__(handle);
+	__ESP_EVENT_CHAIN_CHECK_PTR__(handle, _pattern->events.cend());
 
-	citerator_t result = _events.cend();
+	citerator_t result = _pattern->events.cend();
 
 	// Make sure handle is good
 	if (!strcmp(handle, "null")) return result;
 
 	// Look for handle in the container
-	for (auto it = _events.cbegin(); it != _events.cend(); it++) {
+	const container_t &events = _pattern->events;
+	for (auto it = events.cbegin(); it != events.cend(); it++) {
 		if (!strcmp(handle, it->getHandle())) result = it;
 	}
 	return result;
 }
 
 void EspEventChain::changeTimeOf(size_t pos, unsigned long ms) {
-	__ESP_EVENT_CHAIN_CHECK_POS__(pos);
-	_events.at(pos).setTime(ms);
-	ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-			 "Changed time of event at index = %i to %i", pos, ms);
+	__ESP_EVENT_CHAIN_CHECK_POS__(pos, );
+	modify();
+	_pattern->events[pos].setTime(ms);
+	__ESP_EVENT_LOGI__("Changed time of event at index = %i to %i", pos, ms);
 }
 
 /**
@@ -89,45 +196,48 @@ void EspEventChain::changeTimeOf(size_t pos, unsigned long ms) {
  */
 
 void EspEventChain::push_back(const EspEvent &event) {
-	_events.push_back(event);
-	ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Event added to chain");
+	modify();
+	_pattern->events.push_back(event);
+	_pattern->added(numEvents() - 1);
+	__ESP_EVENT_LOGI__("Event added to chain");
 }
 
 void EspEventChain::insert(size_t event_num, const EspEvent &event) {
-	if (event_num == numEvents()) {
-		_events.push_back(event);
-	} else {
-		__ESP_EVENT_CHAIN_CHECK_POS__(event_num);
-		auto insert_target = _events.begin();
-		std::advance(insert_target, event_num);
-		_events.insert(insert_target, event);
-	}
-	ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Event added to chain");
+	__ESP_EVENT_CHAIN_CHECK_END__(event_num, );
+	modify();
+	auto insert_target = _pattern->events.begin();
+	std::advance(insert_target, event_num);
+	_pattern->events.insert(insert_target, event);
+	_pattern->added(event_num);
+	__ESP_EVENT_LOGI__("Event added to chain");
 }
 
 EspEvent EspEventChain::remove(size_t event_num) {
-	__ESP_EVENT_CHAIN_CHECK_POS__(event_num);
+	__ESP_EVENT_CHAIN_CHECK_POS__(event_num, EspEvent());
 
 	if (isRunning()) {
-		ESP_LOGW(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-				 "Called removed at pos %i / size %i while chain running",
-				 event_num, numEvents());
+		__ESP_EVENT_LOGW__(
+			"Called removed at pos %i / size %i while chain running",
+			event_num, numEvents());
 	}
 
-	EspEvent result = _events.at(event_num);
+	modify();
+	EspEvent result = _pattern->events[event_num];
 
-	auto erase_target = _events.begin();
+	auto erase_target = _pattern->events.begin();
 	std::advance(erase_target, event_num);
-	_events.erase(erase_target);
+	_pattern->events.erase(erase_target);
+	_pattern->removed(event_num);
 
-	ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-			 "Removed event at index = %i, numEvents() = %i", event_num,
-			 numEvents());
+	__ESP_EVENT_LOGI__("Removed event at index = %i, numEvents() = %i",
+					   event_num, numEvents());
 
 	return result;
 }
 
-size_t EspEventChain::numEvents() const { return _events.size(); }
+size_t EspEventChain::numEvents() const {
+	return _fromTable ? _table.numEvents() : _pattern->events.size();
+}
 
 /**
  *
@@ -139,49 +249,215 @@ size_t EspEventChain::numEvents() const { return _events.size(); }
 void EspEventChain::start() { startFrom(0); }
 
 void EspEventChain::startFrom(size_t event_num) {
-	ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Starting chain from index = %i",
-			 event_num);
+	// An empty chain is reported by _start()
+	if (numEvents()) __ESP_EVENT_CHAIN_CHECK_POS__(event_num, );
+	__ESP_EVENT_LOGI__("Starting chain from index = %i", event_num);
 	setCurrentEventTo(event_num);
+	_cycles = 0;
 	_start();
 }
 
-void EspEventChain::runOnceStartFrom(size_t event_num) {
-	ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-			 "Set run-once flag ahead of chain start");
+EspEventCompletion EspEventChain::runOnceStartFrom(size_t event_num) {
+	const EspEventCompletion completion(this, _completions + 1);
+	if (numEvents())
+		__ESP_EVENT_CHAIN_CHECK_POS__(event_num, completion);
+	// The hook of a pass that was stopped would otherwise run for this one
+	if (!_started && !_paused) _passHook = nullptr;
+	__ESP_EVENT_LOGI__("Set run-once flag ahead of chain start");
 	_runOnceFlag = true;
 	startFrom(event_num);
+	return completion;
 }
 
-void EspEventChain::runOnce() { runOnceStartFrom(0); }
+EspEventCompletion EspEventChain::runOnce() { return runOnceStartFrom(0); }
+
+void __ESP_EVENT_ISR_ATTR__ EspEventChain::triggerFromISR(bool once) {
+	requestFromISR(once ? ISR_RUN_ONCE : ISR_START);
+}
+
+void __ESP_EVENT_ISR_ATTR__ EspEventChain::advanceFromISR() {
+	requestFromISR(ISR_ADVANCE);
+}
+
+void __ESP_EVENT_ISR_ATTR__
+EspEventChain::requestFromISR(isr_request_t request) {
+	// The request is published before the count that announces it
+	_isrRequest.store(request, std::memory_order_relaxed);
+	_isrCount.store(_isrCount.load(std::memory_order_relaxed) + 1);
+	EspEventDispatcher *const dispatcher = _dispatcher;
+	if (dispatcher) dispatcher->postFromISR(*this);
+}
+
+void EspEventChain::serviceISRRequest(unsigned long now_ms) {
+	const uint32_t count = _isrCount.load();
+	if (count == _isrHandled) return;
+	_isrHandled = count;
+
+	// Requests made since the last one was handled are coalesced
+	switch (_isrRequest.load(std::memory_order_relaxed)) {
+	case ISR_RUN_ONCE:
+		runOnce();
+		break;
+	case ISR_START:
+		start();
+		break;
+	case ISR_ADVANCE:
+		if (!_started) break;
+		// Counts as the signal the pending event waits for, or the chain
+		// would be left out of the queue
+		if (signalAt(_currentEvent)) _signaled = true;
+		_generation++;
+		_deadline = now_ms;
+		_dispatcher->schedule(*this);
+		break;
+	default:
+		break;
+	}
+}
+
+void EspEventChain::startAt(unsigned long offset_ms) {
+	if (numEvents() == 0 || getCycleTime() == 0) {
+		_start();
+		return;
+	}
+
+	// Binary search for the last event at or before the offset
+	const std::vector<unsigned long> &offsets = getOffsets();
+	const unsigned long offset = offset_ms % offsets.back();
+	_cycles = 0;
+	size_t pos = std::upper_bound(offsets.begin(), offsets.end() - 1, offset) -
+				 offsets.begin() - 1;
+
+	// Events sharing an offset all run, so start from the first of them,
+	// which is never a skipped event
+	while (pos > 0 && offsets[pos - 1] == offset) pos--;
+	if (offsets[pos] == offset) {
+		__ESP_EVENT_LOGI__("Starting chain at offset %lu, index = %i", offset,
+						   pos);
+		_currentEvent = pos;
+		_start();
+		return;
+	}
+
+	// Otherwise the event at pos already ran and the next one is pending
+	const size_t next = pos + 1;
+	if (next == numEvents() && _runOnceFlag) {
+		__ESP_EVENT_LOGI__(
+			"Not starting chain because the single pass is over");
+		_runOnceFlag = false;
+		return;
+	}
+	__ESP_EVENT_LOGI__("Starting chain at offset %lu, index = %i", offset,
+					   next);
+	_currentEvent = next == numEvents() ? 0 : next;
+	_start(scaleTime(offsets[next] - offset));
+}
+
+void EspEventChain::startAtEpoch(unsigned long epoch_ms,
+								 unsigned long phase_ms) {
+	stop();
+	__ESP_EVENT_LOGI__("Starting chain %lu ms after epoch %lu", phase_ms,
+					   epoch_ms);
+	_currentEvent = 0;
+	_cycles = 0;
+	_startFrom(epoch_ms, phase_ms);
+}
+
+void EspEventChain::seek(unsigned long offset_ms) {
+	if (!_started) {
+		__ESP_EVENT_LOGW__("Not seeking because chain is not running");
+		return;
+	}
+	const bool once = _runOnceFlag;
+	const uint32_t cycles = _cycles;
+	stop();
+	_runOnceFlag = once;
+	startAt(offset_ms);
+	_cycles = cycles;
+}
+
+void EspEventChain::pause() {
+	if (!_started) return;
+
+	// Stopping the backend keeps the position, only the timing is captured
+	const unsigned long remaining = getTimeUntilNextEvent();
+	const bool once = _runOnceFlag;
+	stop();
+	_remaining = remaining;
+	_runOnceFlag = once;
+	_paused = true;
+	__ESP_EVENT_LOGI__("Paused chain at index = %i with %lu ms remaining",
+					   _currentEvent, _remaining);
+}
+
+void EspEventChain::resume() {
+	if (!_paused) return;
+	__ESP_EVENT_LOGI__("Resuming chain");
+	_start(_remaining);
+}
 
 void EspEventChain::stop() {
-	if (_started) {
-		_started = false;
-		ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Stopped chain");
-#ifdef ESP32
-		while (_currentEvent != _events.cend()) {
+	if (halt()) release();
+}
+
+bool EspEventChain::halt() {
+	_paused = false;
+	if (!_started) return false;
+	_started = false;
+	_generation++;
+	__ESP_EVENT_LOGI__("Stopped chain");
+	return true;
+}
+
+void EspEventChain::release() {
+	// Queued dispatcher entries are dropped once the generation changes
+	if (_dispatcher) return;
+
+#if defined(ESP32)
+	// Wake the task and wait for it to exit, unless called from the task
+	TaskHandle_t task = _task;
+	if (task && task != xTaskGetCurrentTaskHandle()) {
+		xTaskNotifyGive(task);
+		while (_task) {
 			yield();
 		}
-#else
-		tick.detach();
-#endif
 	}
+#elif defined(ESP8266)
+	tick.detach();
+#endif
 }
 
-void EspEventChain::_start() {
-	if (_events.empty()) {
-		ESP_LOGW(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-				 "Not starting chain because numEvents() = 0");
+void EspEventChain::_start(unsigned long delay_ms) {
+	_startFrom(EspEventClock::now(), delay_ms);
+}
+
+void EspEventChain::_startFrom(unsigned long epoch_ms, unsigned long delay_ms) {
+	if (numEvents() == 0) {
+		__ESP_EVENT_LOGW__("Not starting chain because numEvents() = 0");
 		return;
 	}
 	if (!containsNonzeroEvent()) {
-		ESP_LOGW(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-				 "Not starting chain because all times are zero");
+		__ESP_EVENT_LOGW__("Not starting chain because all times are zero");
 		return;
 	}
+	// Left as it was if refused
+	if (_dispatcher && !_dispatcher->admits(*this)) return;
 	_started = true;
+	_paused = false;
+	_signaled = false;
+	_generation++;
+	_deadline = epoch_ms + delay_ms;
+
+	if (_dispatcher) {
+		// Started at an event that waits, so the wait begins now
+		if (!delay_ms && signalAt(_currentEvent)) {
+			_deadline += scaleTime(timeAt(_currentEvent));
+		}
+		_dispatcher->schedule(*this);
+		return;
+	}
 
-#ifdef ESP32
+#if defined(ESP32)
 
 	// Create a task to do everything
 	xTaskCreate(sHandleTick,	 // Function
@@ -192,77 +468,217 @@ void EspEventChain::_start() {
 				NULL			 // Task handle
 	);
 
+#elif defined(ESP8266)
+
+	// Run first event manually to start cascade, unless it is not yet due
+	const unsigned long now = EspEventClock::now();
+	if ((long)(_deadline - now) > 0)
+		tick.once_ms(_deadline - now, sHandleTick, (void *)this);
+	else
+		sHandleTick(this);
+
 #else
 
-	// Run first event manually to start cascade
-	sHandleTick(this);
+	__ESP_EVENT_LOGW__("No dispatcher attached, chain will not run on host");
 
 #endif
 }
 
 void EspEventChain::sHandleTick(void *ptr) {
-	__ESP_EVENT_CHAIN_CHECK_PTR__(ptr);
+	__ESP_EVENT_CHECK__(ptr, return, "Null pointer exception!");
 	EspEventChain *cast = static_cast<EspEventChain *>(ptr);
 	cast->handleTick();
 }
 
 void EspEventChain::handleTick() {
-#ifdef ESP32
+#if defined(ESP32)
 
+#if __ESP_EVENT_LOG_LEVEL__ >= __ESP_EVENT_LOG_DEBUG__
 	UBaseType_t stack_size = uxTaskGetStackHighWaterMark(NULL);
-	ESP_LOGD(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Stack usage estimate: %i",
-			 stack_size);
+	__ESP_EVENT_LOGD__("Stack usage estimate: %i", stack_size);
+#endif
 
-	TickType_t xLastWakeTime = xTaskGetTickCount();
-	TickType_t xPeriod;
+	// A task that has not recorded itself yet exits here if stopped
+	_task = xTaskGetCurrentTaskHandle();
 
 	while (_started) {
 
-		// Run the event
-		_currentEvent->runEvent();
-
-		if (!advanceToNextCallable()) {
-			ESP_LOGD(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-					 "No more callables to advance to");
-			_runOnceFlag = false;
-			stop();
+		// Sleep until the event is due. The deadline is absolute, so time
+		// taken by callbacks does not add drift, and stop() wakes the task
+		const unsigned long now = EspEventClock::now();
+		if ((long)(_deadline - now) > 0) {
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(_deadline - now +
+												   portTICK_PERIOD_MS - 1));
+			continue;
 		}
 
-		if (uxTaskGetStackHighWaterMark(NULL) > stack_size) {
-			stack_size = uxTaskGetStackHighWaterMark(NULL);
-			ESP_LOGD(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Stack usage estimate: %i",
-					 stack_size);
+		// Run the event
+		if (!dispatch(now)) {
+			__ESP_EVENT_LOGD__("No more callables to advance to");
+			finish();
+			break;
 		}
 
-		// Delay until the next event
-		xPeriod = pdMS_TO_TICKS(_currentEvent->getTime());
-		if (xPeriod) {
-			vTaskDelayUntil(&xLastWakeTime, xPeriod);
-		} else {
-			taskYIELD();
+#if __ESP_EVENT_LOG_LEVEL__ >= __ESP_EVENT_LOG_DEBUG__
+		// Only measured when it can be logged
+		const UBaseType_t high_water = uxTaskGetStackHighWaterMark(NULL);
+		if (high_water > stack_size) {
+			stack_size = high_water;
+			__ESP_EVENT_LOGD__("Stack usage estimate: %i", stack_size);
 		}
+#endif
+
+		taskYIELD();
 	}
 
 	// If we get here stop() was called, so task should delete itself
-	// Position iterator at end() so we can force stop() to block until deletion
-	_currentEvent = _events.cend();
-	ESP_LOGV(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Deleting task...");
+	// Clearing the handle lets stop() return, the position is kept for resume()
+	_task = nullptr;
+
+	// Only once the handle is cleared may the hook start a new task
+	complete();
+	__ESP_EVENT_LOGV__("Deleting task...");
 	vTaskDelete(NULL);
 
-#else
+#elif defined(ESP8266)
 
-	_currentEvent->runEvent();
-	if (!advanceToNextCallable()) return;
+	// Run the event and any that follow it with no delay
+	unsigned long due;
+	do {
+		due = _deadline;
+		if (!dispatch(EspEventClock::now())) {
+			finish();
+			complete();
+			return;
+		}
+		if (!_started) return;
+	} while (_deadline == due);
+
+	// Arm against the absolute deadline so callback time does not add drift
+	const unsigned long now = EspEventClock::now();
+	const unsigned long delay =
+		(long)(_deadline - now) > 0 ? _deadline - now : 0;
+	tick.once_ms(delay, sHandleTick, (void *)this);
 
-	const unsigned long delay = _currentEvent->getTime();
-	if (delay == 0) {
-		handleTick();
+#else
+
+	if (!dispatch(EspEventClock::now())) {
+		finish();
+		complete();
 	}
 
-	tick.once_ms(delay, sHandleTick, (void *)this);
 #endif
 }
 
+bool EspEventChain::dispatch(unsigned long now_ms) {
+	const size_t pos = _currentEvent;
+	EspEventContext context(this, pos, _deadline, now_ms);
+	context._timedOut = signalAt(pos) && !_signaled;
+	_signaled = false;
+
+	// Dropped when the dispatcher has fallen behind, and passed over as if
+	// it had no callback
+	const unsigned long threshold =
+		_dispatcher ? _dispatcher->getShedThreshold() : 0;
+	if (threshold && (long)(now_ms - _deadline) > (long)threshold &&
+		sheddableAt(pos)) {
+		_shed++;
+		_dispatcher->_shed++;
+		__ESP_EVENT_LOGD__("Shed event %i, %lu ms late", pos,
+						   now_ms - _deadline);
+		if (!advanceToNextCallable()) return false;
+		_deadline += scaleTime(timeAt(_currentEvent));
+		return true;
+	}
+
+	// Only events with a declared cost are timed
+	const std::vector<uint32_t> &costs = _pattern->costs;
+	const uint32_t budget_us = pos < costs.size() ? costs[pos] : 0;
+	const uint32_t start = budget_us ? EspEventClock::cycles() : 0;
+	runEventAt(pos, context);
+	bool skip = false;
+	if (budget_us) {
+		EspEventClock::charge(budget_us);
+		const uint32_t elapsed_us =
+			EspEventClock::cyclesToMicros(EspEventClock::cycles() - start);
+		if (elapsed_us > budget_us) {
+			_overruns++;
+			__ESP_EVENT_LOGD__("Event %i took %u us of %u us budget", pos,
+							   elapsed_us, budget_us);
+			if (_overrunHook) _overrunHook(*this, pos, elapsed_us);
+			if (_overrunPolicy == OVERRUN_STOP) return false;
+			skip = _overrunPolicy == OVERRUN_SKIP_NEXT;
+		}
+	}
+
+	// Overrides from the callback take the place of the stored event data
+	const size_t jump = context.getJump();
+	if (jump != EspEventContext::NO_JUMP && jump < numEvents()) {
+		_currentEvent = jump;
+	} else if (!advanceToNextCallable()) {
+		return false;
+	}
+
+	// Delays set by the callback are scaled the same as stored ones
+	const unsigned long delay = context.getNextDelay();
+	_deadline += scaleTime(delay != EspEventContext::NO_DELAY
+							   ? delay
+							   : timeAt(_currentEvent));
+
+	// Skipped after an overrun, its time is kept so later events stay put
+	if (skip) {
+		if (!advanceToNextCallable()) return false;
+		_deadline += scaleTime(timeAt(_currentEvent));
+	}
+
+	// Paused by the callback, so the time left is measured from the new event
+	if (_paused) {
+		_remaining = (long)(_deadline - now_ms) > 0 ? _deadline - now_ms : 0;
+	}
+	return true;
+}
+
+bool EspEventChain::resumeOn(const char *signal, unsigned long now_ms) {
+	const char *const waiting = signalAt(_currentEvent);
+	if (!_started || _signaled || !waiting ||
+		(waiting != signal && strcmp(waiting, signal)))
+		return false;
+
+	// Later events are timed from when the signal was raised
+	_signaled = true;
+	_generation++;
+	_deadline = now_ms;
+	_dispatcher->schedule(*this);
+	return true;
+}
+
+void EspEventChain::finish() {
+	_runOnceFlag = false;
+	_started = false;
+	_paused = false;
+}
+
+void EspEventChain::complete() {
+	// Also reached after an overrun stopped the chain, which is not the end
+	if (!_completed) return;
+	_completed = false;
+	_completions++;
+
+	// Taken first, as either hook may start another pass and give it a hook
+	completion_hook_t pass_hook = nullptr;
+	void *pass_arg = nullptr;
+	if (_passHook && (int32_t)(_completions - _passCompletions) >= 0) {
+		pass_hook = _passHook;
+		pass_arg = _passArg;
+		_passHook = nullptr;
+	}
+
+	__ESP_EVENT_LOGD__("Run-once pass complete");
+	if (_completionSignal && _dispatcher) _dispatcher->raise(_completionSignal);
+	if (_completionHook) _completionHook(*this, _completionArg);
+	if (pass_hook) pass_hook(*this, pass_arg);
+}
+
 bool EspEventChain::advanceToNextCallable() {
 	// Base case, we took a step forward and hit a valid event
 	_currentEvent++;
@@ -272,8 +688,10 @@ bool EspEventChain::advanceToNextCallable() {
 		return advanceToNextCallable();
 	}
 
-	ESP_LOGD(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Reached end of chain");
-	_currentEvent = _events.cbegin();
+	__ESP_EVENT_LOGD__("Reached end of chain");
+	_currentEvent = 0;
+	_cycles++;
+	if (_runOnceFlag) _completed = true;
 	return !_runOnceFlag;
 }
 
@@ -287,26 +705,105 @@ bool EspEventChain::advanceToNextCallable() {
  */
 
 void EspEventChain::setCurrentEventTo(size_t event_num) {
-	__ESP_EVENT_CHAIN_CHECK_POS__(event_num);
-
-	_currentEvent = _events.cbegin();
-	std::advance(_currentEvent, event_num);
+	__ESP_EVENT_CHAIN_CHECK_END__(event_num, );
+	_currentEvent = event_num;
 }
 
 void EspEventChain::construct() {
+	_currentEvent = 0;
+	_deadline = 0;
+	_remaining = 0;
+	_dispatcher = nullptr;
+#ifdef ESP32
+	_task = nullptr;
+#endif
+	_generation = 0;
+	_cycles = 0;
+	_id = 0;
+	_priority = 0;
+	_isrRequest = ISR_NONE;
+	_isrCount = 0;
+	_isrHandled = 0;
+	_isrPosted = false;
+	_overruns = 0;
+	_shed = 0;
+	_overrunHook = nullptr;
+	_overrunPolicy = OVERRUN_SHORTEN_NEXT;
+	_completions = 0;
+	_completionHook = nullptr;
+	_completionArg = nullptr;
+	_completionSignal = nullptr;
+	_passCompletions = 0;
+	_passHook = nullptr;
+	_passArg = nullptr;
+	_timeScale = TIME_SCALE_ONE;
+	_error = ERROR_NONE;
 	_runOnceFlag = false;
 	_started = false;
+	_paused = false;
+	_fromTable = false;
+	_signaled = false;
+	_completed = false;
 }
 
-bool EspEventChain::containsNonzeroEvent() const {
-	for (EspEvent event : _events) {
-		if (event.getTime() != 0) return true;
+const std::vector<unsigned long> &EspEventChain::getOffsets() const {
+	std::vector<unsigned long> &offsets = _pattern->offsets;
+	if (offsets.empty()) {
+		offsets.reserve(numEvents() + 1);
+		unsigned long total = 0;
+		offsets.push_back(0);
+		// The chain skips events without a callback along with their time,
+		// but always comes back to the first
+		for (size_t pos = 1; pos < numEvents(); pos++) {
+			if (callableAt(pos)) total += timeAt(pos);
+			offsets.push_back(total);
+		}
+		if (numEvents()) total += timeAt(0);
+		offsets.push_back(total);
 	}
-	return false;
+	return offsets;
+}
+
+std::shared_ptr<EspEventChain::pattern_t> EspEventChain::sharePattern() const {
+	// Built now so that chains sharing the pattern only read it
+	getOffsets();
+	return _pattern;
+}
+
+void EspEventChain::unshareEvents() {
+	if (_pattern.use_count() == 1) return;
+	__ESP_EVENT_LOGI__("Copying %i shared events ahead of modification",
+					   _pattern->events.size());
+	_pattern = std::make_shared<pattern_t>(*_pattern);
+}
+
+void EspEventChain::detachTable() {
+	if (!_fromTable) return;
+
+	__ESP_EVENT_LOGI__("Copying %i table events into RAM ahead of modification",
+					   _table.numEvents());
+	_pattern->events.reserve(_pattern->events.size() + _table.numEvents());
+	for (size_t pos = 0; pos < _table.numEvents(); pos++) {
+		_pattern->events.push_back(_table.getEvent(pos));
+	}
+	_table.clear();
+	_fromTable = false;
+}
+
+bool EspEventChain::containsNonzeroEvent() const {
+	return numEvents() && getCycleTime() != 0;
 }
 bool EspEventChain::validCurrentEvent() const {
-	return !atEndOfChain() && *_currentEvent;
+	return callableAt(_currentEvent);
+}
+
+bool EspEventChain::callableAt(size_t pos) const {
+	if (pos >= numEvents()) return false;
+	if (_fromTable) {
+		return _table.getCallbackId(pos) != EspEventRegistry::INVALID_ID;
+	}
+	return (bool)_pattern->events[pos];
 }
 bool EspEventChain::atEndOfChain() const {
-	return _currentEvent == _events.cend();
+	return _currentEvent == numEvents();
 }
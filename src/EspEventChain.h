@@ -1,407 +1,1267 @@
-/**
- * @file EspEventChain.h
- * @author Scott Chase Waggener tidal@utexas.edu
- * @date 2/2/18
- *
- * @description
- * Tracks a collection of timings that can be used with <Ticker.h> or another
- * scheduling class to carry out events separated by irregular intervals
- *
- *
- *
- */
-
-#ifndef __ESP_EVENT_CHAIN_H__
-#define __ESP_EVENT_CHAIN_H__
-
-#define __ESP_EVENT_CHAIN_DEBUG_TAG__ "*EspEvent"
-
-#ifndef __ESP_EVENT_CHAIN_DEBUG_SRC__
-#define __ESP_EVENT_CHAIN_DEBUG_SRC__ Serial
-#endif
-
-#define __ESP_EVENT_CHAIN_CHECK_POS__(pos)                                     \
-	if (pos < 0 || pos > _events.size()) {                                     \
-		ESP_LOGE(__ESP_EVENT_CHAIN_DEBUG_TAG__,                                \
-				 "Invalid index = %i - numEvents() = %i", pos,                 \
-				 _events.size());                                              \
-		panic();                                                               \
-	}
-#define __ESP_EVENT_CHAIN_CHECK_PTR__(ptr)                                     \
-	if (ptr == nullptr) {                                                      \
-		ESP_LOGE(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Null pointer exception!");    \
-		panic();                                                               \
-	}
-#define __ESP_EVENT_CHAIN_TRY_CALL__(f)                                        \
-	if (!f) {                                                                  \
-		size_t pos = std::distance(_events.begin(), _currentEvent);            \
-		ESP_LOGW(__ESP_EVENT_CHAIN_DEBUG_TAG__,                                \
-				 "Couldnt call event at pos = %i", pos);                       \
-	} else {                                                                   \
-		(f)();                                                                 \
-	}
-
-#include <Arduino.h>
-
-#include <algorithm>
-#include <functional>
-#include <vector>
-#include <iterator>
-#include "EspDebug.h"
-#include "EspEvent.h"
-
-#ifdef ESP8266
-#include <Ticker.h>
-#endif
-
-/**
- *
- * Holds a collection of EspEvents and coordinates the periodic calls to each
- * event's callback
- *
- *
- */
-class EspEventChain {
-	friend class EspEventFindNextCallable;
-
-  public:
-	typedef std::vector<EspEvent> container_t;
-	typedef container_t::const_iterator citerator_t;
-	typedef container_t::iterator iterator_t;
-	typedef EspEvent::callback_t callback_t;
-
-  private:
-	// The container of EspEvents and the corresponding iterators
-	container_t _events;
-	citerator_t _currentEvent;
-
-#ifdef ESP8266
-	Ticker tick;
-#endif
-
-	bool _started : 1;
-	bool _runOnceFlag : 1;
-
-  public:
-	/**
-	 * @brief Default constructor, nothing gets initialized
-	 *
-	 */
-	EspEventChain();
-
-	/**
-	 * @brief Reserved space constructor, makes room for "num_events" events
-	 *
-	 * @param num_events The expected number of events, 0 <= num_events
-	 *
-	 */
-	EspEventChain(size_t num_events);
-
-	/**
-	 * @brief Populate constructor, puts a variable number of event objects into
-	 * the event chain
-	 *
-	 * @param ...events Comma separated EspEvent objects to put into the chain
-	 *
-	 */
-	template <typename... Args>
-	EspEventChain(EspEvent e1, Args... events) : _events({e1, events...}) {
-		ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__,
-				 "Constructing chain with %i events", sizeof...(events) + 1);
-		construct();
-	}
-
-	/**
-	 * @brief Destructor to ensure the chain is stopped when destroyed
-	 *
-	 * post: stop() called, isRunning() == false
-	 */
-	~EspEventChain() { stop(); }
-
-	/**
-	 * @brief Constructs an EspEvent using the supplied parameters at the end of
-	 * the chain
-	 *
-	 * pre: Undefined behavior if the chain is running when called, may continue
-	 * uninterrupted
-	 *
-	 * @tparam args Constructor arguments for EspEvent
-	 *
-	 * post: numEvents()++, event added to end of chain
-	 *
-	 */
-	template <typename... Args> void emplace_back(Args... args) {
-		_events.emplace_back(args...);
-		ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Event added to chain");
-	}
-
-	/**
-	 * @brief Add an event to the end of the chain
-	 *
-	 * pre: Undefined behavior if the chain is running when called, may continue
-	 * uninterrupted
-	 *
-	 * @param event The EspEvent object to add
-	 *
-	 * post: numEvents()++, event added to end of chain
-	 *
-	 */
-	void push_back(const EspEvent &event);
-
-	/**
-	 * @brief Constructs an EspEvent using the supplied parameters at the the
-	 * given position in the chain
-	 *
-	 * pre: Undefined behavior if the chain is running when called, may continue
-	 * uninterrupted
-	 *
-	 * @param event_num		The position in the chain where the event should
-	 * be constructed 0 <= event_num < numEvents();
-	 * @tparam args 		Constructor arguments for EspEvent
-	 *
-	 * post: numEvents()++, event inserted at event_num, getTimeOf(event_num) =
-	 * event.getTime()
-	 *
-	 */
-	template <typename... Args> void emplace(size_t event_num, Args... args) {
-		__ESP_EVENT_CHAIN_CHECK_POS__(event_num);
-		auto emplace_target = _events.begin();
-		std::advance(emplace_target, event_num);
-		_events.emplace(emplace_target, args...);
-		ESP_LOGI(__ESP_EVENT_CHAIN_DEBUG_TAG__, "Event added to chain");
-	}
-
-	/**
-	 * @brief Add an event to the given position in the chain
-	 *
-	 * pre: Undefined behavior if the chain is running when called, may continue
-	 * uninterrupted
-	 *
-	 * @param event_num		The position in the chain where the event should
-	 * be constructed 0 <= event_num =< numEvents();
-	 *
-	 * @param event		The EspEvent object to add to the chain
-	 *
-	 * post: numEvents()++, event inserted at event_num, getTimeOf(event_num) =
-	 * event.getTime()
-	 *
-	 */
-	void insert(size_t event_num, const EspEvent &event);
-
-	/**
-	 * @brief Removes the event at the given position from the chain
-	 *
-	 * @param event_num		The position in the chain of the event to remove
-	 * 						0 <= event_num < numEvents()
-	 *
-	 * post: numEvents()--
-	 *
-	 * @return The object that was removed
-	 */
-	EspEvent remove(size_t event_num);
-
-	/**
-	 * @brief Gets the number of events in the chain
-	 *
-	 * @return The number of events in the chain, 0 <= numEvents()
-	 */
-	size_t numEvents() const;
-
-	/**
-	 * @brief Change the time associated with the EspEvent at a given index
-	 *
-	 * @param pos           The position of the event to alter, 0 <= pos <
-	 * numEvents()
-	 * @param newTime_ms    The new time in milliseconds, 0 < newTime_ms
-	 *
-	 */
-	void changeTimeOf(size_t pos, unsigned long newTime_ms);
-
-	/**
-	 * @brief Gets the time for the event at a given position
-	 *
-	 * @param pos The index, 0 <= pos < numEvents()
-	 *
-	 * @return _events.at(pos).getTime()
-	 */
-	unsigned long getTimeOf(size_t pos) const;
-
-	/**
-	 * @brief Attempts to look up an EspEvent in the chain using the identifying
-	 * handle of the object
-	 *
-	 * @param handle    The handle to look up, handle != null && handle !=
-	 * "null"
-	 *
-	 * @return  The position of the event with getHandle() == handle in the
-	 * chain if it exists -1 if no match was found
-	 */
-	int getPositionFromHandle(const char *handle) const;
-
-	/**
-	 * @brief Attempts to look up an EspEvent in the chain using the identifying
-	 * handle of the object
-	 *
-	 * @param handle    The handle to look up, handle != null && handle !=
-	 * "null"
-	 *
-	 * @return  A const iterator of the event closest to begin() with
-	 * getHandle()
-	 * == handle if it exists container.cend() if no event was found with that
-	 * handle
-	 */
-	citerator_t getIteratorFromHandle(const char *handle) const;
-
-	/**
-	 * @brief Starts the event chain from the beginning
-	 *
-	 * post:    _currentEvent positioned at the first event,
-	 *          ticker armed to call first event, isRunning() == true
-	 *
-	 */
-	void start();
-
-	/**
-	 * @brief Starts the event chain from the given event number
-	 *
-	 * @param event_num		The position in the chain to start from
-	 * 						0 <= event_num < numEvents()
-	 *
-	 * post:    _currentEvent positioned at event_num,
-	 *          ticker armed to call _currentEvent, isRunning() == true
-	 *
-	 */
-	void startFrom(size_t event_num);
-
-	/**
-	 * @brief Runs the event chain from first to last one time
-	 *
-	 * post:    _currentEvent positioned at the first event,
-	 *          ticker armed to call first event, isRunning() == true
-	 *
-	 */
-	void runOnce();
-
-	/**
-	 * @brief Runs the event chain once starting from the given event number
-	 *
-	 * @param event_num		The position in the chain to start from
-	 * 						0 <= event_num < numEvents()
-	 *
-	 * post: 	currentEvent positioned at event_num,
-	 * 			ticker armed to call _currentEvent, isRunning() == true
-	 *
-	 */
-	void runOnceStartFrom(size_t event_num);
-
-	/**
-	 * @brief Stops the event chain
-	 *
-	 * post: Ticker disarmed, isRunning() == false
-	 *
-	 */
-	void stop();
-
-	/**
-	 * @brief Gets whether the event chain is running
-	 *
-	 * @return true if the chain is running, false otherwise
-	 */
-	bool isRunning() const { return _started; }
-
-	/**
-	 * @brief Gets the time required for the entire event chain to complete.
-	 * Does not account for the time taken by the callbacks
-	 *
-	 * @return  The time in milliseconds for all events to run,
-	 *          equivalent to getTime(0, numEvents() - 1)
-	 */
-	unsigned long getTotalTime() const;
-
-	/**
-	 * @brief Gets the time it will take for the first "index" events to run
-	 *
-	 * @param index The event to sum before, 0 < index < numEvents()
-	 *
-	 * @return Sum of getTimeOf() for events between 0 and index
-	 */
-	unsigned long getTotalTimeBefore(size_t index) const;
-
-  private:
-	void _start();
-
-	/**
-	 * @brief Constructor helper
-	 *
-	 * post: _runOnceFlag = false, _started = false
-	 */
-	void construct();
-
-	/**
-	 * @brief Checks whether the current event contains a callable callback
-	 *
-	 * @return true if valid, false otherwise
-	 */
-	bool validCurrentEvent() const;
-
-	/**
-	 * @brief Checks whether _currentEvent is positioned at the end of _events
-	 *
-	 * @return true if _currentEvent == _events.cend();
-	 */
-	bool atEndOfChain() const;
-
-	/**
-	 * @brief Checks whether the chain contains at least one EspEvent such that
-	 * getTime() != 0
-	 *
-	 * @return true if getTime() != 0 for at least one event in the chain
-	 */
-	bool containsNonzeroEvent() const;
-
-	/**
-	 * @brief Advances the current event to the next event in the chain that is
-	 * callable
-	 *
-	 * post:    _currentEvent > _currentEventOld if the next validCurrentEvent()
-	 * follows _currentEventOld in the container _currentEvent =<
-	 * _currentEventOld if there is no validCurrentEvent() between
-	 * _currentEventOld and the end of the container
-	 *
-	 * @return
-	 */
-	bool advanceToNextCallable();
-
-	/**
-	 * @brief Handles each tick. Use this until we get std::function for ticker
-	 *
-	 * @param ptr   An EspEventChain object pointer cast to void*
-	 *              ptr != null, ptr instanceof EspEventChain
-	 *
-	 * post: ptr cast to EspEventChain, handleTick called on casted object
-	 */
-	static void sHandleTick(void *ptr);
-
-	/**
-	 * @brief Member function called from handleTick that triggers the correct
-	 * event
-	 *
-	 * post:    _currentEvent method called, _currentEvent == next valid event
-	 * in chain, ticker armed to call _currentEvent
-	 *
-	 */
-	void handleTick();
-
-	/**
-	 * @brief Sets the current event to the event at the given position in the
-	 * event chain
-	 *
-	 * @param event_num		The position of an event in the chain,
-	 * 						0 <= event_num < numEvents()
-	 *
-	 * post: _events.at(event_num) = _currentEvent
-	 */
-	void setCurrentEventTo(size_t event_num);
-};
-
+/**
+ * @file EspEventChain.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Tracks a collection of timings that can be used with <Ticker.h> or another
+ * scheduling class to carry out events separated by irregular intervals
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_CHAIN_H__
+#define __ESP_EVENT_CHAIN_H__
+
+#ifndef __ESP_EVENT_CHAIN_DEBUG_SRC__
+#define __ESP_EVENT_CHAIN_DEBUG_SRC__ Serial
+#endif
+
+// Checks made by chain methods, failures are recorded for getLastError()
+#define __ESP_EVENT_CHAIN_CHECK_POS__(pos, ret)                                \
+	__ESP_EVENT_CHECK__((pos) < numEvents(),                                   \
+						{                                                      \
+							_error = ERROR_BAD_INDEX;                          \
+							return ret;                                        \
+						},                                                     \
+						"Invalid index = %i - numEvents() = %i", pos,          \
+						numEvents())
+#define __ESP_EVENT_CHAIN_CHECK_END__(pos, ret)                                \
+	__ESP_EVENT_CHECK__((pos) <= numEvents(),                                  \
+						{                                                      \
+							_error = ERROR_BAD_INDEX;                          \
+							return ret;                                        \
+						},                                                     \
+						"Invalid index = %i - numEvents() = %i", pos,          \
+						numEvents())
+#define __ESP_EVENT_CHAIN_CHECK_PTR__(ptr, ret)                                \
+	__ESP_EVENT_CHECK__((ptr) != nullptr,                                      \
+						{                                                      \
+							_error = ERROR_NULL_POINTER;                       \
+							return ret;                                        \
+						},                                                     \
+						"Null pointer exception!")
+#define __ESP_EVENT_CHAIN_TRY_CALL__(f)                                        \
+	if (!f) {                                                                  \
+		__ESP_EVENT_LOGW__("Couldnt call event at pos = %i", _currentEvent);  \
+	} else {                                                                   \
+		(f)();                                                                 \
+	}
+
+#include "EspEventCheck.h"
+#include "EspEventLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <iterator>
+#include <memory>
+#include "EspEvent.h"
+#include "EspEventClock.h"
+#include "EspEventContext.h"
+#include "EspEventDispatcher.h"
+#include "EspEventTable.h"
+
+#ifdef ESP8266
+#include <Ticker.h>
+#endif
+
+class EspEventChain;
+
+/**
+ *
+ * Returned by EspEventChain::runOnce() to tell when that pass is over,
+ * without polling isRunning() or sleeping for the length of the chain
+ *
+ */
+class EspEventCompletion {
+	EspEventChain *_chain;
+	uint32_t _completions;
+
+  public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param chain			The chain making the pass
+	 * @param completions	getCompletions() once the pass is over
+	 */
+	EspEventCompletion(EspEventChain *chain, uint32_t completions)
+		: _chain(chain), _completions(completions) {}
+
+	/**
+	 * @brief Gets whether the pass reached the end, or the chain was stopped
+	 * before it could. A paused pass is not done
+	 */
+	bool isDone() const;
+
+	/**
+	 * @brief Calls hook once this pass is over, right away if isDone().
+	 * The hook runs once and leaves the completion hook of the chain alone.
+	 * Only the last hook given for a pass is kept, and a pass that is
+	 * stopped drops its hook when the next one starts
+	 *
+	 * @return this
+	 */
+	EspEventCompletion &then(void (*hook)(EspEventChain &chain, void *arg),
+							 void *arg = nullptr);
+
+	/**
+	 * @brief Gets the chain making the pass
+	 */
+	EspEventChain &getChain() const { return *_chain; }
+};
+
+/**
+ *
+ * Holds a collection of EspEvents and coordinates the periodic calls to each
+ * event's callback
+ *
+ *
+ */
+class EspEventChain {
+	friend class EspEventFindNextCallable;
+	friend class EspEventDispatcher;
+	friend class EspEventTimeline;
+	friend class EspEventSnapshot;
+	friend class EspEventChainGroup;
+	friend class EspEventAnalysis;
+	friend class EspEventCompletion;
+
+  public:
+	typedef std::vector<EspEvent> container_t;
+	typedef container_t::const_iterator citerator_t;
+	typedef container_t::iterator iterator_t;
+	typedef EspEvent::callback_t callback_t;
+
+	// Called after an event runs longer than its declared cost
+	typedef void (*overrun_hook_t)(EspEventChain &chain, size_t pos,
+								   unsigned long elapsed_us);
+
+	// Called after a run-once pass reaches the end of the chain
+	typedef void (*completion_hook_t)(EspEventChain &chain, void *arg);
+
+	// What the chain does after an overrun
+	enum overrun_policy_t : uint8_t {
+		OVERRUN_SHORTEN_NEXT, // Run the next event on its original deadline
+		OVERRUN_SKIP_NEXT,	// Skip the next event to get back on schedule
+		OVERRUN_STOP		  // Stop the chain
+	};
+
+	// Time scale of 1.0 in 16.16 fixed point
+	static const uint32_t TIME_SCALE_ONE = 1UL << 16;
+
+	// Requests that can be made from an interrupt
+	enum isr_request_t : uint8_t {
+		ISR_NONE = 0,
+		ISR_RUN_ONCE,
+		ISR_START,
+		ISR_ADVANCE
+	};
+
+	// Failed checks, recorded when __ESP_EVENT_CHECK_POLICY__ is
+	// __ESP_EVENT_CHECK_ERROR__
+	enum error_code_t : uint8_t {
+		ERROR_NONE = 0,
+		ERROR_BAD_INDEX,
+		ERROR_NULL_POINTER
+	};
+
+  private:
+	// Events and what is declared about them, shared by copies of the chain
+	// until one of them is modified
+	struct pattern_t {
+		container_t events;
+
+		// Declared execution cost of each event in microseconds, empty
+		// until set. Also the budget callbacks are checked against when the
+		// chain runs
+		std::vector<uint32_t> costs;
+
+		// Signal each event waits for in place of its delay, empty until set
+		std::vector<const char *> signals;
+
+		// Offset of each event from the start of the cycle followed by the
+		// cycle time. Built on first use, or before the pattern is shared so
+		// that copies only read it, and dropped when the chain is modified
+		std::vector<unsigned long> offsets;
+
+		pattern_t() {}
+		explicit pattern_t(container_t &&list) : events(std::move(list)) {}
+
+		// Keeps costs and signals in step with an event added at pos
+		void added(size_t pos) {
+			if (!costs.empty()) costs.insert(costs.begin() + pos, 0);
+			if (!signals.empty())
+				signals.insert(signals.begin() + pos, nullptr);
+		}
+
+		// Keeps costs and signals in step with the event removed from pos
+		void removed(size_t pos) {
+			if (pos < costs.size()) costs.erase(costs.begin() + pos);
+			if (pos < signals.size()) signals.erase(signals.begin() + pos);
+		}
+	};
+
+	// The shared pattern, and the position of the current event
+	std::shared_ptr<pattern_t> _pattern;
+	size_t _currentEvent;
+
+	// EspEventClock time at which the current event is due
+	unsigned long _deadline;
+
+	// Time that was left before the current event when the chain was paused
+	unsigned long _remaining;
+
+	// Serialized events used in place of the pattern's until the chain is
+	// modified
+	EspEventTable _table;
+
+	// Events that ran longer than their declared cost
+	uint32_t _overruns;
+
+	// Sheddable events dropped because the dispatcher fell behind
+	uint32_t _shed;
+	overrun_hook_t _overrunHook;
+	overrun_policy_t _overrunPolicy;
+
+	// Run-once passes that reached the end, and who is told when they do
+	uint32_t _completions;
+	completion_hook_t _completionHook;
+	void *_completionArg;
+	const char *_completionSignal;
+
+	// Given by EspEventCompletion::then(), run once _completions reaches
+	// _passCompletions and then cleared
+	uint32_t _passCompletions;
+	completion_hook_t _passHook;
+	void *_passArg;
+
+	// Backend that runs the chain in place of a Ticker / task, if any
+	EspEventDispatcher *_dispatcher;
+
+	// Incremented on every start / stop so stale dispatcher entries are known
+	uint32_t _generation;
+
+	// Number of times the chain has wrapped back to the first event
+	uint32_t _cycles;
+
+	// Chosen by the application to tell chains apart in traces
+	uint16_t _id;
+
+	// Order among chains whose events are due at the same time
+	uint8_t _priority;
+
+	// Last request made from an interrupt, taken by the dispatcher once
+	// _isrCount differs from the count it handled. Only plain loads and
+	// stores are used, as ESP8266 has no atomic read-modify-write
+	std::atomic<uint8_t> _isrRequest;
+	std::atomic<uint32_t> _isrCount;
+	uint32_t _isrHandled;
+
+	// Whether the chain waits in the interrupt queue of its dispatcher
+	std::atomic<bool> _isrPosted;
+
+	// Factors applied to every delay, 16.16 fixed point
+	std::atomic<uint32_t> _timeScale;
+	static std::atomic<uint32_t> sGlobalTimeScale;
+
+#ifdef ESP8266
+	Ticker tick;
+#endif
+
+#ifdef ESP32
+	// Task running the chain, cleared by the task as it exits
+	TaskHandle_t volatile _task;
+#endif
+
+	// Last check that failed
+	mutable error_code_t _error;
+
+	bool _started : 1;
+	bool _paused : 1;
+	bool _runOnceFlag : 1;
+	bool _fromTable : 1;
+	bool _signaled : 1;
+	bool _completed : 1;
+
+  public:
+	/**
+	 * @brief Default constructor, nothing gets initialized
+	 *
+	 */
+	EspEventChain();
+
+	/**
+	 * @brief Reserved space constructor, makes room for "num_events" events
+	 *
+	 * @param num_events The expected number of events, 0 <= num_events
+	 *
+	 */
+	EspEventChain(size_t num_events);
+
+	/**
+	 * @brief Populate constructor, puts a variable number of event objects into
+	 * the event chain
+	 *
+	 * @param ...events Comma separated EspEvent objects to put into the chain
+	 *
+	 */
+	template <typename... Args>
+	EspEventChain(EspEvent e1, Args... events)
+		: _pattern(std::make_shared<pattern_t>(
+			  container_t({e1, events...}))) {
+		__ESP_EVENT_LOGI__("Constructing chain with %i events",
+						   sizeof...(events) + 1);
+		construct();
+	}
+
+	/**
+	 * @brief Table constructor, runs the events of a serialized table in
+	 * place without copying them into RAM. The first call that modifies the
+	 * chain copies the table into EspEvent objects
+	 *
+	 * pre: The data viewed by table outlives the chain
+	 *
+	 * @param table A loaded EspEventTable
+	 *
+	 */
+	explicit EspEventChain(const EspEventTable &table);
+
+	/**
+	 * @brief Destructor to ensure the chain is stopped when destroyed
+	 *
+	 * post: stop() called, isRunning() == false
+	 */
+	~EspEventChain();
+
+	/**
+	 * @brief Copy constructor, shares the events of another chain along with
+	 * their costs and signals. They are copied when either chain is next
+	 * modified
+	 *
+	 * post: isRunning() == false, the copy is not attached to a dispatcher,
+	 * sharesEventsWith(other) == true
+	 */
+	EspEventChain(const EspEventChain &other);
+
+	/**
+	 * @brief Copy assignment, replaces the events of this chain with those of
+	 * another, shared until either chain is modified
+	 *
+	 * post: isRunning() == false, dispatcher of this chain is kept,
+	 * sharesEventsWith(other) == true
+	 */
+	EspEventChain &operator=(const EspEventChain &other);
+
+	/**
+	 * @brief Constructs an EspEvent using the supplied parameters at the end of
+	 * the chain
+	 *
+	 * pre: Undefined behavior if the chain is running when called, may continue
+	 * uninterrupted
+	 *
+	 * @tparam args Constructor arguments for EspEvent
+	 *
+	 * post: numEvents()++, event added to end of chain
+	 *
+	 */
+	template <typename... Args> void emplace_back(Args... args) {
+		modify();
+		_pattern->events.emplace_back(args...);
+		_pattern->added(numEvents() - 1);
+		__ESP_EVENT_LOGI__("Event added to chain");
+	}
+
+	/**
+	 * @brief Add an event to the end of the chain
+	 *
+	 * pre: Undefined behavior if the chain is running when called, may continue
+	 * uninterrupted
+	 *
+	 * @param event The EspEvent object to add
+	 *
+	 * post: numEvents()++, event added to end of chain
+	 *
+	 */
+	void push_back(const EspEvent &event);
+
+	/**
+	 * @brief Constructs an EspEvent using the supplied parameters at the the
+	 * given position in the chain
+	 *
+	 * pre: Undefined behavior if the chain is running when called, may continue
+	 * uninterrupted
+	 *
+	 * @param event_num		The position in the chain where the event should
+	 * be constructed 0 <= event_num =< numEvents();
+	 * @tparam args 		Constructor arguments for EspEvent
+	 *
+	 * post: numEvents()++, event inserted at event_num, getTimeOf(event_num) =
+	 * event.getTime()
+	 *
+	 */
+	template <typename... Args> void emplace(size_t event_num, Args... args) {
+		__ESP_EVENT_CHAIN_CHECK_END__(event_num, );
+		modify();
+		auto emplace_target = _pattern->events.begin();
+		std::advance(emplace_target, event_num);
+		_pattern->events.emplace(emplace_target, args...);
+		_pattern->added(event_num);
+		__ESP_EVENT_LOGI__("Event added to chain");
+	}
+
+	/**
+	 * @brief Add an event to the given position in the chain
+	 *
+	 * pre: Undefined behavior if the chain is running when called, may continue
+	 * uninterrupted
+	 *
+	 * @param event_num		The position in the chain where the event should
+	 * be constructed 0 <= event_num =< numEvents();
+	 *
+	 * @param event		The EspEvent object to add to the chain
+	 *
+	 * post: numEvents()++, event inserted at event_num, getTimeOf(event_num) =
+	 * event.getTime()
+	 *
+	 */
+	void insert(size_t event_num, const EspEvent &event);
+
+	/**
+	 * @brief Removes the event at the given position from the chain
+	 *
+	 * @param event_num		The position in the chain of the event to remove
+	 * 						0 <= event_num < numEvents()
+	 *
+	 * post: numEvents()--
+	 *
+	 * @return The object that was removed
+	 */
+	EspEvent remove(size_t event_num);
+
+	/**
+	 * @brief Gets the number of events in the chain
+	 *
+	 * @return The number of events in the chain, 0 <= numEvents()
+	 */
+	size_t numEvents() const;
+
+	/**
+	 * @brief Change the time associated with the EspEvent at a given index
+	 *
+	 * @param pos           The position of the event to alter, 0 <= pos <
+	 * numEvents()
+	 * @param newTime_ms    The new time in milliseconds, 0 < newTime_ms
+	 *
+	 */
+	void changeTimeOf(size_t pos, unsigned long newTime_ms);
+
+	/**
+	 * @brief Gets the time for the event at a given position
+	 *
+	 * @param pos The index, 0 <= pos < numEvents()
+	 *
+	 * @return The time in milliseconds
+	 */
+	unsigned long getTimeOf(size_t pos) const;
+
+	/**
+	 * @brief Gets a copy of the event at a given position
+	 *
+	 * @param pos The index, 0 <= pos < numEvents()
+	 *
+	 * @return The event, rebuilt from the table for table backed chains
+	 */
+	EspEvent getEvent(size_t pos) const;
+
+	/**
+	 * @brief Declares how long the callback of an event takes to run. Used
+	 * by EspEventSimulator, and as a budget when the chain runs normally: a
+	 * callback that takes longer counts as an overrun. Modifies the chain,
+	 * so events shared with copies are copied first
+	 *
+	 * @param pos       The position of the event, 0 <= pos < numEvents()
+	 * @param cost_us   The execution time in microseconds
+	 *
+	 */
+	void setCostOf(size_t pos, unsigned long cost_us);
+
+	/**
+	 * @brief Gets the declared execution cost of an event
+	 *
+	 * @param pos The index, 0 <= pos < numEvents()
+	 *
+	 * @return Time in microseconds, 0 if none was declared
+	 */
+	unsigned long getCostOf(size_t pos) const;
+
+	/**
+	 * @brief Makes an event wait for a signal raised on the dispatcher of
+	 * the chain, rather than for a fixed delay. The wait starts when the
+	 * event before it runs, and the event runs as soon as the signal is
+	 * raised. Its time becomes a timeout, after which it runs anyway and
+	 * EspEventContext::isTimedOut() is true. Signals raised while the chain
+	 * is not waiting are not remembered
+	 *
+	 * Chains without a dispatcher treat the event as a timed one. Events
+	 * shared with copies of the chain are copied first
+	 *
+	 * @param pos		The position of the event, 0 <= pos < numEvents()
+	 * @param signal	Name of the signal, nullptr to go back to a delay. Not
+	 * copied, so it must outlive the chain
+	 *
+	 * post: an event with time 0 waits with no timeout
+	 */
+	void setSignalOf(size_t pos, const char *signal);
+
+	/**
+	 * @brief Gets the signal an event waits for
+	 *
+	 * @param pos The index, 0 <= pos < numEvents()
+	 *
+	 * @return nullptr if the event waits for its delay
+	 */
+	const char *getSignalOf(size_t pos) const;
+
+	/**
+	 * @brief Gets the number of callbacks that ran longer than their
+	 * declared cost. Only events given a cost are timed
+	 *
+	 * @return Overruns since the chain was constructed or resetOverruns()
+	 */
+	uint32_t getOverruns() const { return _overruns; }
+
+	/**
+	 * @brief Zeroes the overrun count
+	 *
+	 * post: getOverruns() == 0
+	 */
+	void resetOverruns() { _overruns = 0; }
+
+	/**
+	 * @brief Gets the number of sheddable events that were dropped because
+	 * the dispatcher running the chain fell behind
+	 *
+	 * @return Events dropped since the chain was constructed
+	 */
+	uint32_t getShed() const { return _shed; }
+
+	/**
+	 * @brief Sets a function to call after each overrun, before the policy
+	 * is applied. Runs on the backend of the chain, right after the callback
+	 *
+	 * @param hook	The function, nullptr for none
+	 */
+	void setOverrunHook(overrun_hook_t hook) { _overrunHook = hook; }
+
+	/**
+	 * @brief Sets what the chain does after an overrun. Deadlines are kept
+	 * absolute, so by default the next event runs on time and its delay is
+	 * in effect shortened by the overrun
+	 *
+	 * @param policy	OVERRUN_SHORTEN_NEXT by default
+	 */
+	void setOverrunPolicy(overrun_policy_t policy) { _overrunPolicy = policy; }
+
+	/**
+	 * @brief Gets what the chain does after an overrun
+	 */
+	overrun_policy_t getOverrunPolicy() const { return _overrunPolicy; }
+
+	/**
+	 * @brief Sets a function to call each time a run-once pass reaches the
+	 * end of the chain. Runs on the backend of the chain once it has
+	 * stopped, so the hook may start this chain or the next one of a
+	 * pipeline with no gap. On ESP8266 that is the Ticker callback
+	 *
+	 * @param hook	The function, nullptr for none
+	 * @param arg	Passed to hook
+	 */
+	void setCompletionHook(completion_hook_t hook, void *arg = nullptr) {
+		_completionArg = arg;
+		_completionHook = hook;
+	}
+
+	/**
+	 * @brief Sets a signal to raise on the dispatcher of the chain each time
+	 * a run-once pass reaches the end, so events or coroutines waiting for
+	 * it resume. See setSignalOf()
+	 *
+	 * @param signal	Name of the signal, nullptr for none. Not copied
+	 */
+	void setCompletionSignal(const char *signal) {
+		_completionSignal = signal;
+	}
+
+	/**
+	 * @brief Gets the number of run-once passes that reached the end
+	 *
+	 * @return Passes completed since the chain was constructed
+	 */
+	uint32_t getCompletions() const { return _completions; }
+
+	/**
+	 * @brief Gets the position of the event that will run next
+	 *
+	 * @return 0 <= getCurrentEvent() < numEvents()
+	 */
+	size_t getCurrentEvent() const { return _currentEvent; }
+
+	/**
+	 * @brief Checks whether two chains use the same copy of their events, as
+	 * they do after one is copied from the other until either is modified
+	 *
+	 * @return true if the events are stored once for both chains
+	 */
+	bool sharesEventsWith(const EspEventChain &other) const {
+		return _pattern == other._pattern;
+	}
+
+	/**
+	 * @brief Sets a number identifying the chain in an EspEventTrace. Copies
+	 * of the chain do not keep it
+	 *
+	 * @param id	Any value, 0 by default
+	 */
+	void setId(uint16_t id) { _id = id; }
+
+	/**
+	 * @brief Gets the number identifying the chain
+	 *
+	 * @return The value given to setId(), 0 by default
+	 */
+	uint16_t getId() const { return _id; }
+
+	/**
+	 * @brief Sets the priority of every event of the chain. When events of
+	 * several chains on one dispatcher are due at the same time, the highest
+	 * priority runs first. Used from the next time the chain is queued
+	 *
+	 * @param priority	0 by default, events with a higher priority of their
+	 * own keep it
+	 */
+	void setPriority(uint8_t priority) { _priority = priority; }
+
+	/**
+	 * @brief Gets the priority of the chain
+	 *
+	 * @return The value given to setPriority(), 0 by default
+	 */
+	uint8_t getPriority() const { return _priority; }
+
+	/**
+	 * @brief Gets the dispatcher running this chain
+	 *
+	 * @return nullptr if the chain uses its own Ticker / task
+	 */
+	EspEventDispatcher *getDispatcher() const { return _dispatcher; }
+
+	/**
+	 * @brief Starts the chain from an interrupt. Only the request is stored,
+	 * and the dispatcher of the chain acts on it the next time it runs or is
+	 * queried, as if runOnce() or start() were called there. Placed in IRAM
+	 * and safe to call from any ISR
+	 *
+	 * pre: The chain is added to a dispatcher, otherwise the request is
+	 * ignored
+	 *
+	 * @param once	true to run through the chain once, false to repeat it
+	 */
+	void triggerFromISR(bool once = true);
+
+	/**
+	 * @brief Runs the pending event of a running chain from an interrupt,
+	 * rather than waiting for its delay to pass or its signal to be raised.
+	 * The events after it keep their delays, measured from when the event
+	 * runs. Ignored if the chain is not running when the dispatcher takes
+	 * the request
+	 *
+	 * pre: The chain is added to a dispatcher
+	 */
+	void advanceFromISR();
+
+	/**
+	 * @brief Attempts to look up an EspEvent in the chain using the identifying
+	 * handle of the object
+	 *
+	 * @param handle    The handle to look up, handle != null && handle !=
+	 * "null"
+	 *
+	 * @return  The position of the event with getHandle() == handle in the
+	 * chain if it exists -1 if no match was found
+	 */
+	int getPositionFromHandle(const char *handle) const;
+
+	/**
+	 * @brief Attempts to look up an EspEvent in the chain using the identifying
+	 * handle of the object
+	 *
+	 * @param handle    The handle to look up, handle != null && handle !=
+	 * "null"
+	 *
+	 * @return  A const iterator of the event closest to begin() with
+	 * getHandle()
+	 * == handle if it exists container.cend() if no event was found with that
+	 * handle or the chain is still backed by an EspEventTable
+	 */
+	citerator_t getIteratorFromHandle(const char *handle) const;
+
+	/**
+	 * @brief Starts the event chain from the beginning
+	 *
+	 * post:    _currentEvent positioned at the first event,
+	 *          ticker armed to call first event, isRunning() == true
+	 *
+	 */
+	void start();
+
+	/**
+	 * @brief Starts the event chain from the given event number
+	 *
+	 * @param event_num		The position in the chain to start from
+	 * 						0 <= event_num < numEvents()
+	 *
+	 * post:    _currentEvent positioned at event_num,
+	 *          ticker armed to call _currentEvent, isRunning() == true
+	 *
+	 */
+	void startFrom(size_t event_num);
+
+	/**
+	 * @brief Runs the event chain from first to last one time
+	 *
+	 * post:    _currentEvent positioned at the first event,
+	 *          ticker armed to call first event, isRunning() == true
+	 *
+	 * @return Handle that tells when this pass is over
+	 */
+	EspEventCompletion runOnce();
+
+	/**
+	 * @brief Runs the event chain once starting from the given event number
+	 *
+	 * @param event_num		The position in the chain to start from
+	 * 						0 <= event_num < numEvents()
+	 *
+	 * post: 	currentEvent positioned at event_num,
+	 * 			ticker armed to call _currentEvent, isRunning() == true
+	 *
+	 * @return Handle that tells when this pass is over
+	 */
+	EspEventCompletion runOnceStartFrom(size_t event_num);
+
+	/**
+	 * @brief Starts the event chain at a time offset into its cycle, as if it
+	 * had been running since offset_ms ago. Events before the offset are not
+	 * run, and the next one runs after the remainder of its delay
+	 *
+	 * @param offset_ms		Time into the cycle, taken modulo getCycleTime()
+	 *
+	 * post:    _currentEvent positioned at the first event run at or after
+	 *          offset_ms, isRunning() == true
+	 *
+	 */
+	void startAt(unsigned long offset_ms);
+
+	/**
+	 * @brief Starts the event chain from the first event, due at a fixed
+	 * time rather than now. Chains started against the same epoch stay in
+	 * phase however long apart the calls are made, see EspEventChainGroup
+	 *
+	 * @param epoch_ms	EspEventClock time the phase is measured from, at
+	 * most one millis() wrap away
+	 * @param phase_ms	Delay of the first event after the epoch
+	 *
+	 * post: isRunning() == true, the first event runs at epoch_ms + phase_ms,
+	 * or right away if that has passed
+	 */
+	void startAtEpoch(unsigned long epoch_ms, unsigned long phase_ms = 0);
+
+	/**
+	 * @brief Moves a running chain to a time offset into its cycle, keeping
+	 * whether it runs once
+	 *
+	 * @param offset_ms		Time into the cycle, taken modulo getCycleTime()
+	 *
+	 * post: getCurrentOffset() == offset_ms % getCycleTime() if the chain was
+	 * running, otherwise nothing is done
+	 *
+	 */
+	void seek(unsigned long offset_ms);
+
+	/**
+	 * @brief Stops the event chain
+	 *
+	 * post: Ticker disarmed, isRunning() == false, isPaused() == false
+	 *
+	 */
+	void stop();
+
+	/**
+	 * @brief Stops the event chain, keeping the pending event and the time
+	 * left before it
+	 *
+	 * post: isRunning() == false, isPaused() == true if the chain was running
+	 *
+	 */
+	void pause();
+
+	/**
+	 * @brief Restarts a paused chain, running the pending event once the time
+	 * left when paused has passed
+	 *
+	 * post: isRunning() == true if the chain was paused
+	 *
+	 */
+	void resume();
+
+	/**
+	 * @brief Gets whether the event chain is paused
+	 *
+	 * @return true if pause() was called and the chain was not since started,
+	 * resumed or stopped
+	 */
+	bool isPaused() const { return _paused; }
+
+	/**
+	 * @brief Gets the number of passes completed through the chain
+	 *
+	 * @return Times the chain wrapped back to the first event since it was
+	 * started, kept by pause() and snapshots
+	 */
+	uint32_t getCycles() const { return _cycles; }
+
+	/**
+	 * @brief Scales every delay of the chain without modifying its events.
+	 * Safe to call while the chain runs, and used from the next event on
+	 *
+	 * @param scale	Factor applied to delays, 2.0 runs at half speed,
+	 * 0 < scale < 65536
+	 */
+	void setTimeScale(float scale) { _timeScale = toFixed(scale); }
+
+	/**
+	 * @brief Gets the time scale of the chain
+	 *
+	 * @return The factor set by setTimeScale(), 1.0 by default
+	 */
+	float getTimeScale() const { return (float)_timeScale / TIME_SCALE_ONE; }
+
+	/**
+	 * @brief Scales the delays of every chain, on top of each chain's own
+	 * time scale. Nonzero delays are kept at 1 ms or more however small
+	 * the combined scale
+	 *
+	 * @param scale	Factor applied to delays, 0 < scale < 65536
+	 */
+	static void setGlobalTimeScale(float scale) {
+		sGlobalTimeScale = toFixed(scale);
+	}
+
+	/**
+	 * @brief Gets the time scale applied to every chain
+	 *
+	 * @return The factor set by setGlobalTimeScale(), 1.0 by default
+	 */
+	static float getGlobalTimeScale() {
+		return (float)sGlobalTimeScale / TIME_SCALE_ONE;
+	}
+
+	/**
+	 * @brief Gets the last check that failed in a method of this chain. Only
+	 * recorded when built with the error code check policy, in which case the
+	 * method returns 0, -1 or an empty event and leaves the chain as it was
+	 *
+	 * @return ERROR_NONE if no check has failed since clearError()
+	 */
+	error_code_t getLastError() const { return _error; }
+
+	/**
+	 * @brief Forgets the last failed check
+	 *
+	 * post: getLastError() == ERROR_NONE
+	 */
+	void clearError() { _error = ERROR_NONE; }
+
+	/**
+	 * @brief Gets whether the event chain is running
+	 *
+	 * @return true if the chain is running, false otherwise
+	 */
+	bool isRunning() const { return _started; }
+
+	/**
+	 * @brief Gets the time required for the entire event chain to complete.
+	 * Does not account for the time taken by the callbacks
+	 *
+	 * @return  The time in milliseconds for all events to run,
+	 *          equivalent to getTime(0, numEvents() - 1)
+	 */
+	unsigned long getTotalTime() const;
+
+	/**
+	 * @brief Gets the time one pass of the chain takes as it runs. Events
+	 * after the first without a callback are skipped along with their time
+	 *
+	 * @return getTotalTime() less the times of skipped events
+	 */
+	unsigned long getCycleTime() const;
+
+	/**
+	 * @brief Gets the time it will take for the first "index" events to run
+	 *
+	 * @param index The event to sum before, 0 < index < numEvents()
+	 *
+	 * @return Sum of getTimeOf() for events between 0 and index
+	 */
+	unsigned long getTotalTimeBefore(size_t index) const;
+
+	/**
+	 * @brief Gets how far a running chain is into its cycle
+	 *
+	 * @return Time in milliseconds since the cycle began,
+	 *         0 <= getCurrentOffset() < getCycleTime(), 0 if not running
+	 */
+	unsigned long getCurrentOffset() const;
+
+	/**
+	 * @brief Gets the time left before the pending event of a running chain
+	 *
+	 * @return Time in milliseconds, 0 if the event is due or the chain is not
+	 * running
+	 */
+	unsigned long getTimeUntilNextEvent() const;
+
+  private:
+	/**
+	 * @brief Starts the backend with the current event due after delay_ms
+	 */
+	void _start(unsigned long delay_ms = 0);
+
+	/**
+	 * @brief Starts the backend with the current event due delay_ms after
+	 * epoch_ms
+	 */
+	void _startFrom(unsigned long epoch_ms, unsigned long delay_ms);
+
+	/**
+	 * @brief First half of stop(), after which no more events run
+	 *
+	 * @return true if the chain was running and its backend must still be
+	 * released
+	 */
+	bool halt();
+
+	/**
+	 * @brief Second half of stop(), disarms the Ticker or waits for the task
+	 * to exit
+	 */
+	void release();
+
+	/**
+	 * @brief Stores a request for the dispatcher and wakes it
+	 */
+	void requestFromISR(isr_request_t request);
+
+	/**
+	 * @brief Acts on the request made from an interrupt, if there is a new
+	 * one. Called by the dispatcher
+	 *
+	 * @param now_ms	The current EspEventClock time
+	 */
+	void serviceISRRequest(unsigned long now_ms);
+
+	/**
+	 * @brief Gets the product of the chain and global time scales
+	 *
+	 * @return The factor in 32.32 fixed point, at least 1
+	 */
+	uint64_t combinedScale() const {
+		return (uint64_t)_timeScale.load(std::memory_order_relaxed) *
+			   sGlobalTimeScale.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Applies the chain and global time scales to a delay
+	 *
+	 * @return ms scaled, rounded down but at least 1 if ms != 0 so a scaled
+	 * chain cannot spin
+	 */
+	unsigned long scaleTime(unsigned long ms) const {
+		const uint64_t scale = combinedScale();
+		if (scale == (uint64_t)TIME_SCALE_ONE * TIME_SCALE_ONE) return ms;
+		// ms * scale takes 96 bits, so each half of the scale is applied
+		// on its own
+		const uint64_t scaled =
+			(uint64_t)ms * (uint32_t)(scale >> 32) +
+			(((uint64_t)ms * (uint32_t)scale) >> 32);
+		if (scaled == 0) return ms != 0;
+		const unsigned long longest = ~0UL;
+		return scaled > longest ? longest : (unsigned long)scaled;
+	}
+
+	/**
+	 * @brief Undoes scaleTime() on a scaled time
+	 *
+	 * @param ms	Scaled time, taken as at most 0xFFFFFFFF
+	 *
+	 * @return ms unscaled, rounded down
+	 */
+	unsigned long unscaleTime(unsigned long ms) const {
+		const uint64_t scale = std::max<uint64_t>(combinedScale(), 1);
+		const uint64_t capped = std::min<uint64_t>(ms, 0xFFFFFFFF);
+		const uint64_t unscaled = (capped << 32) / scale;
+		const unsigned long longest = ~0UL;
+		return unscaled > longest ? longest : (unsigned long)unscaled;
+	}
+
+	/**
+	 * @brief Converts a time scale to 16.16 fixed point, at least 1 / 65536
+	 */
+	static uint32_t toFixed(float scale) {
+		const float fixed = scale * TIME_SCALE_ONE + 0.5f;
+		if (fixed < 1) return 1;
+		return fixed > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)fixed;
+	}
+
+	/**
+	 * @brief Called ahead of every change to the events of the chain
+	 *
+	 * post: _fromTable == false, _pattern not shared, offsets dropped
+	 */
+	void modify() {
+		unshareEvents();
+		detachTable();
+		_pattern->offsets.clear();
+	}
+
+	/**
+	 * @brief Gives the chain its own copy of events shared with other chains
+	 *
+	 * post: _pattern.use_count() == 1
+	 */
+	void unshareEvents();
+
+	/**
+	 * @brief Gets the pattern for a copy of the chain to share
+	 *
+	 * post: Offsets built
+	 */
+	std::shared_ptr<pattern_t> sharePattern() const;
+
+	/**
+	 * @brief Gets the offset of every event from the start of the cycle.
+	 * Skipped events share the offset of the event run before them
+	 *
+	 * @return Offset of each event, followed by getCycleTime()
+	 */
+	const std::vector<unsigned long> &getOffsets() const;
+
+	/**
+	 * @brief Copies the events of a table backed chain into _pattern so that
+	 * they can be modified
+	 *
+	 * post: _fromTable == false
+	 */
+	void detachTable();
+
+	/**
+	 * @brief Gets the time of the event at a given position without bounds
+	 * checking
+	 */
+	unsigned long timeAt(size_t pos) const {
+		return _fromTable ? _table.getTimeOf(pos)
+						  : _pattern->events[pos].getTime();
+	}
+
+	/**
+	 * @brief Runs the event at a given position without bounds checking
+	 */
+	void runEventAt(size_t pos, EspEventContext &context) const {
+		if (_fromTable)
+			_table.runEvent(pos);
+		else
+			_pattern->events[pos].runEvent(context);
+	}
+
+	/**
+	 * @brief Gets the priority the pending event is queued with
+	 *
+	 * @return The higher of the chain and event priorities
+	 */
+	uint8_t pendingPriority() const {
+		const container_t &events = _pattern->events;
+		const uint8_t event = _fromTable || _currentEvent >= events.size()
+								  ? 0
+								  : events[_currentEvent].getPriority();
+		return event > _priority ? event : _priority;
+	}
+
+	/**
+	 * @brief Constructor helper
+	 *
+	 * post: _runOnceFlag = false, _started = false, _paused = false,
+	 * _fromTable = false
+	 */
+	void construct();
+
+	/**
+	 * @brief Checks whether the current event contains a callable callback
+	 *
+	 * @return true if valid, false otherwise
+	 */
+	bool validCurrentEvent() const;
+
+	/**
+	 * @brief Checks whether the event at a given position contains a callable
+	 * callback
+	 *
+	 * @return false if pos == numEvents()
+	 */
+	bool callableAt(size_t pos) const;
+
+	/**
+	 * @brief Checks whether the event at a given position may be dropped
+	 * under load
+	 *
+	 * @return false for table backed chains
+	 */
+	bool sheddableAt(size_t pos) const {
+		return !_fromTable && _pattern->events[pos].isSheddable();
+	}
+
+	/**
+	 * @brief Gets the signal the event at a given position waits for
+	 *
+	 * @return nullptr if none was set
+	 */
+	const char *signalAt(size_t pos) const {
+		const std::vector<const char *> &signals = _pattern->signals;
+		return pos < signals.size() ? signals[pos] : nullptr;
+	}
+
+	/**
+	 * @brief Checks whether the pending event waits for a signal with no
+	 * timeout, in which case the chain is not queued until it is raised
+	 */
+	bool waitsForSignal() const {
+		return !_signaled && signalAt(_currentEvent) &&
+			   timeAt(_currentEvent) == 0;
+	}
+
+	/**
+	 * @brief Resumes the chain if its pending event waits for a signal
+	 *
+	 * @param now_ms	The current EspEventClock time
+	 *
+	 * @return true if the chain was waiting for signal
+	 */
+	bool resumeOn(const char *signal, unsigned long now_ms);
+
+	/**
+	 * @brief Checks whether _currentEvent is positioned past the last event
+	 *
+	 * @return true if _currentEvent == numEvents();
+	 */
+	bool atEndOfChain() const;
+
+	/**
+	 * @brief Checks whether the chain contains at least one EspEvent such that
+	 * getTime() != 0, not counting events the chain skips
+	 *
+	 * @return true if getCycleTime() != 0
+	 */
+	bool containsNonzeroEvent() const;
+
+	/**
+	 * @brief Advances the current event to the next event in the chain that is
+	 * callable
+	 *
+	 * post:    _currentEvent > _currentEventOld if the next validCurrentEvent()
+	 * follows _currentEventOld in the container _currentEvent =<
+	 * _currentEventOld if there is no validCurrentEvent() between
+	 * _currentEventOld and the end of the container
+	 *
+	 * @return
+	 */
+	bool advanceToNextCallable();
+
+	/**
+	 * @brief Handles each tick. Use this until we get std::function for ticker
+	 *
+	 * @param ptr   An EspEventChain object pointer cast to void*
+	 *              ptr != null, ptr instanceof EspEventChain
+	 *
+	 * post: ptr cast to EspEventChain, handleTick called on casted object
+	 */
+	static void sHandleTick(void *ptr);
+
+	/**
+	 * @brief Member function called from handleTick that triggers the correct
+	 * event
+	 *
+	 * post:    _currentEvent method called, _currentEvent == next valid event
+	 * in chain, ticker armed to call _currentEvent
+	 *
+	 */
+	void handleTick();
+
+	/**
+	 * @brief Runs the current event and moves on to the next one. Shared by
+	 * every backend. A delay or jump set on the EspEventContext by the
+	 * callback is used in place of the stored event data for this pass
+	 *
+	 * @param now_ms	The EspEventClock time at which the event runs
+	 *
+	 * post:	_currentEvent == next valid event in chain, _deadline == time
+	 * at which it is due
+	 *
+	 * @return false if the chain has run to completion, true otherwise
+	 */
+	bool dispatch(unsigned long now_ms);
+
+	/**
+	 * @brief Marks the chain as finished after a run-once pass completes
+	 *
+	 * post: isRunning() == false, isPaused() == false, _runOnceFlag == false
+	 */
+	void finish();
+
+	/**
+	 * @brief Tells the completion hook and signal that the pass reached the
+	 * end, if it did. Called by the backend after finish()
+	 */
+	void complete();
+
+	/**
+	 * @brief Sets the current event to the event at the given position in the
+	 * event chain
+	 *
+	 * @param event_num		The position of an event in the chain,
+	 * 						0 <= event_num < numEvents()
+	 *
+	 * post: _currentEvent = event_num
+	 */
+	void setCurrentEventTo(size_t event_num);
+};
+
+inline bool EspEventCompletion::isDone() const {
+	return (int32_t)(_chain->getCompletions() - _completions) >= 0 ||
+		   (!_chain->isRunning() && !_chain->isPaused());
+}
+
+inline EspEventCompletion &
+EspEventCompletion::then(EspEventChain::completion_hook_t hook, void *arg) {
+	if (isDone()) {
+		if (hook) hook(*_chain, arg);
+		return *this;
+	}
+	_chain->_passCompletions = _completions;
+	_chain->_passHook = hook;
+	_chain->_passArg = arg;
+	return *this;
+}
+
 #endif
\ No newline at end of file
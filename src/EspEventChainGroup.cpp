@@ -0,0 +1,63 @@
+#include "EspEventChainGroup.h"
+
+EspEventChainGroup::EspEventChainGroup() : _epoch(0) {}
+
+void EspEventChainGroup::add(EspEventChain &chain, unsigned long phase_ms) {
+	const size_t index = indexOf(chain);
+	if (index < _members.size()) {
+		_members[index].phase_ms = phase_ms;
+		return;
+	}
+	_members.push_back({&chain, phase_ms, false});
+}
+
+void EspEventChainGroup::remove(EspEventChain &chain) {
+	_members.erase(std::remove_if(_members.begin(), _members.end(),
+								  [&](const member_t &member) {
+									  return member.chain == &chain;
+								  }),
+				   _members.end());
+}
+
+unsigned long EspEventChainGroup::getPhaseOf(const EspEventChain &chain) const {
+	const size_t index = indexOf(chain);
+	return index < _members.size() ? _members[index].phase_ms : 0;
+}
+
+void EspEventChainGroup::start(unsigned long delay_ms) {
+	startAtEpoch(EspEventClock::now() + delay_ms);
+}
+
+void EspEventChainGroup::startAtEpoch(unsigned long epoch_ms) {
+	// Stopped together first, so no chain runs an event of the old epoch
+	// while the others restart
+	stop();
+	_epoch = epoch_ms;
+	__ESP_EVENT_LOGI__("Starting %i chains at epoch %lu", _members.size(),
+					   epoch_ms);
+	for (const member_t &member : _members) {
+		member.chain->startAtEpoch(epoch_ms, member.phase_ms);
+	}
+}
+
+void EspEventChainGroup::stop() {
+	// Every chain is marked stopped before any backend is waited on
+	for (member_t &member : _members) member.halted = member.chain->halt();
+	for (member_t &member : _members) {
+		if (member.halted) member.chain->release();
+	}
+}
+
+bool EspEventChainGroup::isRunning() const {
+	for (const member_t &member : _members) {
+		if (member.chain->isRunning()) return true;
+	}
+	return false;
+}
+
+size_t EspEventChainGroup::indexOf(const EspEventChain &chain) const {
+	for (size_t i = 0; i < _members.size(); i++) {
+		if (_members[i].chain == &chain) return i;
+	}
+	return _members.size();
+}
@@ -0,0 +1,131 @@
+/**
+ * @file EspEventChainGroup.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Starts and stops several EspEventChains together against a shared epoch,
+ * keeping them phase-locked
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_CHAIN_GROUP_H__
+#define __ESP_EVENT_CHAIN_GROUP_H__
+
+#include <stddef.h>
+#include <vector>
+#include "EspEventChain.h"
+
+/**
+ *
+ * Set of chains that start from one epoch. Each chain runs its first event
+ * a fixed phase after the epoch, and since every later deadline is
+ * measured from the one before it the chains never drift apart, no matter
+ * when each backend got going
+ *
+ * 		EspEventChainGroup group;
+ * 		group.add(red, 0);
+ * 		group.add(green, 33);
+ * 		group.add(blue, 66);
+ * 		group.start();
+ *
+ * Unlike EspEventTimeline the chains keep their own backends, so they may
+ * still be paused, sought or modified one at a time
+ *
+ */
+class EspEventChainGroup {
+
+	struct member_t {
+		EspEventChain *chain;
+		unsigned long phase_ms;
+		bool halted;
+	};
+
+	std::vector<member_t> _members;
+	unsigned long _epoch;
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: size() == 0
+	 */
+	EspEventChainGroup();
+
+	EspEventChainGroup(const EspEventChainGroup &) = delete;
+	EspEventChainGroup &operator=(const EspEventChainGroup &) = delete;
+
+	/**
+	 * @brief Adds a chain, or changes its phase if already added. Takes
+	 * effect from the next start()
+	 *
+	 * @param chain		The chain, outlives the group or is removed first
+	 * @param phase_ms	Delay of the chain's first event after the epoch
+	 */
+	void add(EspEventChain &chain, unsigned long phase_ms = 0);
+
+	/**
+	 * @brief Removes a chain from the group, leaving it running if it was
+	 */
+	void remove(EspEventChain &chain);
+
+	/**
+	 * @brief Gets the number of chains in the group
+	 */
+	size_t size() const { return _members.size(); }
+
+	/**
+	 * @brief Gets the phase of a chain
+	 *
+	 * @return Delay after the epoch, 0 if chain is not in the group
+	 */
+	unsigned long getPhaseOf(const EspEventChain &chain) const;
+
+	/**
+	 * @brief Starts every chain from its first event, against an epoch
+	 * delay_ms from now
+	 *
+	 * post: each chain runs its first event at getEpoch() + its phase
+	 */
+	void start(unsigned long delay_ms = 0);
+
+	/**
+	 * @brief Starts every chain from its first event against a given epoch,
+	 * such as one shared with another device
+	 *
+	 * @param epoch_ms	EspEventClock time the phases are measured from
+	 */
+	void startAtEpoch(unsigned long epoch_ms);
+
+	/**
+	 * @brief Stops every chain. No chain runs another event once the first
+	 * one is stopped, even on ESP32 where each has its own task
+	 *
+	 * post: isRunning() == false
+	 */
+	void stop();
+
+	/**
+	 * @brief Gets whether any chain of the group is running
+	 */
+	bool isRunning() const;
+
+	/**
+	 * @brief Gets the epoch of the last start
+	 *
+	 * @return EspEventClock time in milliseconds
+	 */
+	unsigned long getEpoch() const { return _epoch; }
+
+  private:
+	/**
+	 * @brief Gets the position of a chain
+	 *
+	 * @return size() if chain is not in the group
+	 */
+	size_t indexOf(const EspEventChain &chain) const;
+};
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file EspEventCheck.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Compile time policy for the argument checks made by the library
+ *
+ * Build flags:
+ *
+ *   -D__ESP_EVENT_CHECK_POLICY__=0     No checks, invalid arguments are
+ *                                      undefined behavior
+ *   -D__ESP_EVENT_CHECK_POLICY__=1     Log and panic() (default)
+ *   -D__ESP_EVENT_CHECK_POLICY__=2     Log, record an error code and return
+ *                                      a neutral value
+ *
+ */
+
+#ifndef __ESP_EVENT_CHECK_H__
+#define __ESP_EVENT_CHECK_H__
+
+#define __ESP_EVENT_CHECK_NONE__ 0
+#define __ESP_EVENT_CHECK_PANIC__ 1
+#define __ESP_EVENT_CHECK_ERROR__ 2
+
+#ifndef __ESP_EVENT_CHECK_POLICY__
+#define __ESP_EVENT_CHECK_POLICY__ __ESP_EVENT_CHECK_PANIC__
+#endif
+
+#include "EspEventLog.h"
+
+/**
+ * Checks cond, and if it does not hold logs the message and either panics or
+ * runs the statement fail, which should return from the caller
+ */
+#if __ESP_EVENT_CHECK_POLICY__ == __ESP_EVENT_CHECK_NONE__
+#define __ESP_EVENT_CHECK__(cond, fail, ...) ((void)0)
+#elif __ESP_EVENT_CHECK_POLICY__ == __ESP_EVENT_CHECK_PANIC__
+#define __ESP_EVENT_CHECK__(cond, fail, ...)                                   \
+	do {                                                                       \
+		if (!(cond)) {                                                         \
+			__ESP_EVENT_LOGE__(__VA_ARGS__);                                   \
+			panic();                                                           \
+		}                                                                      \
+	} while (0)
+#else
+#define __ESP_EVENT_CHECK__(cond, fail, ...)                                   \
+	do {                                                                       \
+		if (!(cond)) {                                                         \
+			__ESP_EVENT_LOGE__(__VA_ARGS__);                                   \
+			fail;                                                              \
+		}                                                                      \
+	} while (0)
+#endif
+
+#endif
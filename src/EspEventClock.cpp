@@ -0,0 +1,5 @@
+#include "EspEventClock.h"
+
+EspEventClock::source_t EspEventClock::_source = nullptr;
+EspEventClock::source_t EspEventClock::_microSource = nullptr;
+EspEventClock::charge_t EspEventClock::_charge = nullptr;
@@ -0,0 +1,172 @@
+/**
+ * @file EspEventClock.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Millisecond time source shared by EspEventChain and its backends
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_CLOCK_H__
+#define __ESP_EVENT_CLOCK_H__
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#elif defined(__linux__)
+#include <time.h>
+#else
+#include <chrono>
+#endif
+
+#include <stdint.h>
+
+/**
+ *
+ * Time source used to compute event deadlines and lateness. The platform
+ * clock can be replaced, which is how EspEventSimulator runs chains on
+ * virtual time
+ *
+ */
+class EspEventClock {
+
+  public:
+	typedef unsigned long (*source_t)();
+	typedef void (*charge_t)(unsigned long us);
+
+  private:
+	static source_t _source;
+	static source_t _microSource;
+	static charge_t _charge;
+
+  public:
+	/**
+	 * @brief Gets the current time
+	 *
+	 * @return Time in milliseconds from the installed source, otherwise
+	 * millis() on device and the monotonic clock on host
+	 */
+	static unsigned long now() {
+		if (_source) return _source();
+		return platformNow();
+	}
+
+	/**
+	 * @brief Gets the current time with microsecond resolution, used to time
+	 * the callbacks themselves
+	 *
+	 * @return Time in microseconds from the installed source, otherwise
+	 * micros() on device and the monotonic clock on host. Wraps around
+	 * along with unsigned long
+	 */
+	static unsigned long nowMicros() {
+		if (_microSource) return _microSource();
+		if (_source) return _source() * 1000UL;
+		return platformNowMicros();
+	}
+
+	/**
+	 * @brief Gets a free running counter for timing short sections of code,
+	 * such as a single callback
+	 *
+	 * @return CPU cycles on device, nowMicros() on host, wrapping at 32 bits
+	 */
+	static uint32_t cycles() {
+#ifdef ARDUINO
+		return ESP.getCycleCount();
+#else
+		return nowMicros();
+#endif
+	}
+
+	/**
+	 * @brief Converts a difference between two cycles() readings
+	 *
+	 * @return Time in microseconds
+	 */
+	static uint32_t cyclesToMicros(uint32_t cycles) {
+#ifdef ARDUINO
+		return cycles / ESP.getCpuFreqMHz();
+#else
+		return cycles;
+#endif
+	}
+
+	/**
+	 * @brief Accounts for the time a callback is declared to take. Called by
+	 * a chain after each event with a cost, before the callback is timed.
+	 * The platform clock moves on its own, so this does nothing unless a
+	 * source that needs it, such as a virtual clock, installed a hook
+	 *
+	 * @param us	The declared cost in microseconds
+	 */
+	static void charge(unsigned long us) {
+		if (_charge) _charge(us);
+	}
+
+	/**
+	 * @brief Replaces the time source
+	 *
+	 * @param source	The function returning the time in milliseconds,
+	 * nullptr to restore the platform clock
+	 */
+	static void setSource(source_t source) { _source = source; }
+
+	/**
+	 * @brief Replaces the microsecond time source. Without one, nowMicros()
+	 * follows the millisecond source if one is installed
+	 *
+	 * @param source	The function returning the time in microseconds,
+	 * nullptr to go back to the default
+	 */
+	static void setMicroSource(source_t source) { _microSource = source; }
+
+	/**
+	 * @brief Sets the function that advances the installed source by the
+	 * cost of a callback
+	 *
+	 * @param hook	The function, nullptr for none
+	 */
+	static void setChargeHook(charge_t hook) { _charge = hook; }
+
+	/**
+	 * @brief Gets the platform clock, ignoring any installed source
+	 *
+	 * @return Time in milliseconds. On Linux this is CLOCK_MONOTONIC
+	 */
+	static unsigned long platformNow() {
+#ifdef ARDUINO
+		return millis();
+#elif defined(__linux__)
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#else
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+				   std::chrono::steady_clock::now().time_since_epoch())
+			.count();
+#endif
+	}
+
+	/**
+	 * @brief Gets the platform clock in microseconds, ignoring any installed
+	 * source
+	 */
+	static unsigned long platformNowMicros() {
+#ifdef ARDUINO
+		return micros();
+#elif defined(__linux__)
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+				   std::chrono::steady_clock::now().time_since_epoch())
+			.count();
+#endif
+	}
+};
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file EspEventContext.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Scheduling information passed to context callbacks of an EspEvent
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_CONTEXT_H__
+#define __ESP_EVENT_CONTEXT_H__
+
+#include <stddef.h>
+
+class EspEventChain;
+
+/**
+ *
+ * Describes the event being run to a context callback. Built on the stack by
+ * the chain for each event, so it is only valid for the duration of the
+ * callback
+ *
+ * The callback may also override what the chain does next, either the delay
+ * before the next event or which event runs next. Overrides apply to this
+ * pass only and never modify the events stored in the chain
+ *
+ */
+class EspEventContext {
+	friend class EspEvent;
+	friend class EspEventChain;
+
+  public:
+	static const unsigned long NO_DELAY = (unsigned long)-1;
+	static const size_t NO_JUMP = (size_t)-1;
+
+  private:
+	EspEventChain *_chain;
+	size_t _index;
+	unsigned long _scheduled_ms;
+	unsigned long _start_ms;
+	void *_payload;
+	unsigned long _nextDelay;
+	size_t _jump;
+	bool _timedOut;
+
+  public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param chain         The chain running the event, nullptr if the event
+	 * is run on its own
+	 * @param index         The position of the event in the chain
+	 * @param scheduled_ms  The time at which the event was due
+	 * @param start_ms      The time at which the event actually ran
+	 */
+	EspEventContext(EspEventChain *chain = nullptr, size_t index = 0,
+					unsigned long scheduled_ms = 0,
+					unsigned long start_ms = 0)
+		: _chain(chain), _index(index), _scheduled_ms(scheduled_ms),
+		  _start_ms(start_ms), _payload(nullptr), _nextDelay(NO_DELAY),
+		  _jump(NO_JUMP), _timedOut(false) {}
+
+	/**
+	 * @brief Gets the chain running the event
+	 *
+	 * @return nullptr if the event was not run by a chain
+	 */
+	EspEventChain *getChain() const { return _chain; }
+
+	/**
+	 * @brief Gets the position of the event in the chain
+	 *
+	 * @return 0 <= getIndex() < getChain()->numEvents()
+	 */
+	size_t getIndex() const { return _index; }
+
+	/**
+	 * @brief Gets the time at which the event was due
+	 *
+	 * @return Time in milliseconds on the EspEventClock
+	 */
+	unsigned long getScheduledTime() const { return _scheduled_ms; }
+
+	/**
+	 * @brief Gets the time at which the event actually ran
+	 *
+	 * @return Time in milliseconds on the EspEventClock
+	 */
+	unsigned long getStartTime() const { return _start_ms; }
+
+	/**
+	 * @brief Gets how late the event ran
+	 *
+	 * @return getStartTime() - getScheduledTime(), 0 if the event ran early
+	 */
+	unsigned long getLateness() const {
+		return (long)(_start_ms - _scheduled_ms) > 0 ? _start_ms - _scheduled_ms
+													 : 0;
+	}
+
+	/**
+	 * @brief Gets whether the event waited for a signal that was not raised
+	 * before its timeout. See EspEventChain::setSignalOf()
+	 *
+	 * @return false for events that wait for their delay
+	 */
+	bool isTimedOut() const { return _timedOut; }
+
+	/**
+	 * @brief Gets the payload given to the event at construction
+	 *
+	 * @return The payload cast to T*
+	 */
+	template <typename T = void> T *getPayload() const {
+		return static_cast<T *>(_payload);
+	}
+
+	/**
+	 * @brief Overrides the delay before the next event for this pass
+	 *
+	 * @param ms	The delay in milliseconds, used in place of the next
+	 * event's getTime()
+	 */
+	void setNextDelay(unsigned long ms) { _nextDelay = ms; }
+
+	/**
+	 * @brief Makes the chain continue from the given event instead of the
+	 * one that follows this event
+	 *
+	 * @param index	The position of the next event, 0 <= index < numEvents()
+	 */
+	void jumpTo(size_t index) { _jump = index; }
+
+	/**
+	 * @brief Gets the delay override set by the callback
+	 *
+	 * @return NO_DELAY if no override was set
+	 */
+	unsigned long getNextDelay() const { return _nextDelay; }
+
+	/**
+	 * @brief Gets the jump target set by the callback
+	 *
+	 * @return NO_JUMP if no jump was requested
+	 */
+	size_t getJump() const { return _jump; }
+};
+
+#endif
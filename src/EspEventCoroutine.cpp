@@ -0,0 +1,87 @@
+#include "EspEventCoroutine.h"
+
+#if __ESP_EVENT_COROUTINE__
+
+static_assert(EspEventCoroutinePool::FRAME_SIZE % alignof(max_align_t) == 0,
+			  "__ESP_EVENT_COROUTINE_FRAME_SIZE__ must keep frames aligned");
+
+alignas(max_align_t) static uint8_t
+	sFrames[EspEventCoroutinePool::FRAMES][EspEventCoroutinePool::FRAME_SIZE];
+static bool sInUse[EspEventCoroutinePool::FRAMES];
+
+void *EspEventCoroutinePool::allocate(size_t size) {
+	if (size > FRAME_SIZE) {
+		__ESP_EVENT_LOGE__("Coroutine frame of %i bytes is too large", size);
+		return nullptr;
+	}
+	for (size_t i = 0; i < FRAMES; i++) {
+		if (!sInUse[i]) {
+			sInUse[i] = true;
+			return sFrames[i];
+		}
+	}
+	__ESP_EVENT_LOGE__("No free coroutine frame");
+	return nullptr;
+}
+
+void EspEventCoroutinePool::release(void *frame) {
+	const size_t i = ((uint8_t *)frame - &sFrames[0][0]) / FRAME_SIZE;
+	if (i < FRAMES) sInUse[i] = false;
+}
+
+size_t EspEventCoroutinePool::numFree() {
+	size_t count = 0;
+	for (size_t i = 0; i < FRAMES; i++) count += !sInUse[i];
+	return count;
+}
+
+/**
+ * Every event resumes the coroutine. The stored times only keep the chain
+ * startable and mark which wait has a timeout, the delay itself is set by
+ * step() each time. Room for signals is made now so that step() never
+ * allocates
+ */
+EspEventCoroutine::promise_type::promise_type()
+	: chain(EspEvent(1, step, this), EspEvent(0, step, this),
+			EspEvent(1, step, this)),
+	  delay(0), signal(nullptr), timedOut(false) {
+	chain.setSignalOf(STEP_SIGNAL, nullptr);
+}
+
+EspEventCoroutine &EspEventCoroutine::operator=(EspEventCoroutine &&other) {
+	if (this != &other) {
+		if (_handle) _handle.destroy();
+		_handle = other._handle;
+		other._handle = nullptr;
+	}
+	return *this;
+}
+
+EspEventCoroutine::~EspEventCoroutine() {
+	// The chain is destroyed with the frame, leaving its dispatcher
+	if (_handle) _handle.destroy();
+}
+
+void EspEventCoroutine::step(EspEventContext &context) {
+	promise_type &promise = *context.getPayload<promise_type>();
+	promise.timedOut = context.isTimedOut();
+
+	const handle_t handle = handle_t::from_promise(promise);
+	handle.resume();
+	if (handle.done()) {
+		promise.chain.stop();
+		return;
+	}
+
+	// Point the chain at the event matching the wait the coroutine is on
+	if (!promise.signal) {
+		context.jumpTo(STEP_SLEEP);
+	} else {
+		const size_t next = promise.delay ? STEP_SIGNAL_TIMEOUT : STEP_SIGNAL;
+		promise.chain.setSignalOf(next, promise.signal);
+		context.jumpTo(next);
+	}
+	context.setNextDelay(promise.delay);
+}
+
+#endif
@@ -0,0 +1,260 @@
+/**
+ * @file EspEventCoroutine.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * C++20 coroutines that sleep and wait for signals on the same scheduler as
+ * EspEventChain, with frames taken from a fixed pool
+ *
+ * Only available when the compiler supports coroutines, which needs
+ * -std=c++20 or later. __ESP_EVENT_COROUTINE__ is 1 when it does
+ *
+ * Build flags:
+ *
+ *   -D__ESP_EVENT_COROUTINE_FRAMES__=8         Coroutines alive at once
+ *   -D__ESP_EVENT_COROUTINE_FRAME_SIZE__=1024  Largest frame in bytes
+ *
+ */
+
+#ifndef __ESP_EVENT_COROUTINE_H__
+#define __ESP_EVENT_COROUTINE_H__
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define __ESP_EVENT_COROUTINE__ 1
+#endif
+#endif
+
+#ifndef __ESP_EVENT_COROUTINE__
+#define __ESP_EVENT_COROUTINE__ 0
+#endif
+
+#ifndef __ESP_EVENT_COROUTINE_FRAMES__
+#define __ESP_EVENT_COROUTINE_FRAMES__ 8
+#endif
+
+#ifndef __ESP_EVENT_COROUTINE_FRAME_SIZE__
+#define __ESP_EVENT_COROUTINE_FRAME_SIZE__ 1024
+#endif
+
+#if __ESP_EVENT_COROUTINE__
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <stddef.h>
+#include "EspEventChain.h"
+
+/**
+ *
+ * Fixed pool of coroutine frames, so the frame itself never comes from the
+ * heap. Frames are taken and returned on the thread running the
+ * dispatcher, and are not safe to share between threads
+ *
+ */
+class EspEventCoroutinePool {
+
+  public:
+	static const size_t FRAMES = __ESP_EVENT_COROUTINE_FRAMES__;
+	static const size_t FRAME_SIZE = __ESP_EVENT_COROUTINE_FRAME_SIZE__;
+
+	/**
+	 * @brief Takes a free frame
+	 *
+	 * @param size	Bytes needed by the frame
+	 *
+	 * @return nullptr if size > FRAME_SIZE or every frame is in use
+	 */
+	static void *allocate(size_t size);
+
+	/**
+	 * @brief Returns a frame taken by allocate()
+	 */
+	static void release(void *frame);
+
+	/**
+	 * @brief Gets the number of frames not in use
+	 *
+	 * @return 0 <= numFree() <= FRAMES
+	 */
+	static size_t numFree();
+};
+
+/**
+ *
+ * A coroutine run by an EspEventChain. Each time the coroutine is resumed
+ * it runs up to its next co_await, and the chain then waits as asked
+ * before resuming it again, so a sequence keeps its state in local
+ * variables rather than across several callbacks
+ *
+ * 		EspEventCoroutine blink(int pin) {
+ * 			for (;;) {
+ * 				digitalWrite(pin, HIGH);
+ * 				co_await EspEventCoroutine::sleep(20);
+ * 				digitalWrite(pin, LOW);
+ * 				if (!co_await EspEventCoroutine::signal("button", 1000))
+ * 					Serial.println("timed out");
+ * 			}
+ * 		}
+ *
+ * 		EspEventCoroutine task = blink(2);
+ * 		dispatcher.add(task.getChain());
+ * 		task.start();
+ *
+ * The chain lives in the coroutine frame and has one event for each kind
+ * of wait. Only the frame is pooled: creating the coroutine allocates the
+ * events of its chain on the heap, once, after which resuming allocates
+ * nothing. Signals are those raised with EspEventDispatcher::raise(), and
+ * are only seen on a dispatcher
+ *
+ */
+class EspEventCoroutine {
+
+  public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> handle_t;
+
+	/**
+	 * Request made by the awaiter the coroutine is suspended on
+	 */
+	struct promise_type {
+		EspEventChain chain;
+		unsigned long delay;
+		const char *signal;
+		bool timedOut;
+
+		promise_type();
+
+		EspEventCoroutine get_return_object() {
+			return EspEventCoroutine(handle_t::from_promise(*this));
+		}
+		static EspEventCoroutine get_return_object_on_allocation_failure() {
+			return EspEventCoroutine(nullptr);
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void *operator new(size_t size) noexcept {
+			return EspEventCoroutinePool::allocate(size);
+		}
+		static void operator delete(void *frame) {
+			EspEventCoroutinePool::release(frame);
+		}
+	};
+
+	/**
+	 * Suspends the coroutine for a delay
+	 */
+	struct sleep_t {
+		unsigned long ms;
+
+		bool await_ready() const { return false; }
+		void await_suspend(handle_t handle) const {
+			handle.promise().delay = ms;
+			handle.promise().signal = nullptr;
+		}
+		void await_resume() const {}
+	};
+
+	/**
+	 * Suspends the coroutine until a signal is raised
+	 */
+	struct signal_t {
+		const char *name;
+		unsigned long timeout_ms;
+		handle_t handle;
+
+		bool await_ready() const { return false; }
+		void await_suspend(handle_t suspended) {
+			handle = suspended;
+			handle.promise().delay = timeout_ms;
+			handle.promise().signal = name;
+		}
+
+		// false if the timeout passed first
+		bool await_resume() const { return !handle.promise().timedOut; }
+	};
+
+  private:
+	// Events of the chain, one per kind of wait
+	enum step_t : size_t { STEP_SLEEP, STEP_SIGNAL, STEP_SIGNAL_TIMEOUT };
+
+	handle_t _handle;
+
+  public:
+	explicit EspEventCoroutine(handle_t handle) : _handle(handle) {}
+	EspEventCoroutine(EspEventCoroutine &&other) noexcept
+		: _handle(other._handle) {
+		other._handle = nullptr;
+	}
+	EspEventCoroutine &operator=(EspEventCoroutine &&other);
+
+	EspEventCoroutine(const EspEventCoroutine &) = delete;
+	EspEventCoroutine &operator=(const EspEventCoroutine &) = delete;
+
+	/**
+	 * @brief Destructor, stops the chain and frees the frame
+	 */
+	~EspEventCoroutine();
+
+	/**
+	 * @brief Gets a suspension of ms milliseconds, measured from when the
+	 * coroutine last resumed as the delays of a chain are
+	 */
+	static sleep_t sleep(unsigned long ms) { return sleep_t{ms}; }
+	static sleep_t sleep(std::chrono::milliseconds ms) {
+		return sleep_t{(unsigned long)ms.count()};
+	}
+
+	/**
+	 * @brief Gets a suspension until a signal is raised. co_await gives
+	 * false if the timeout passed first
+	 *
+	 * @param name			Name of the signal, outlives the wait
+	 * @param timeout_ms	Longest wait, 0 for no timeout
+	 */
+	static signal_t signal(const char *name, unsigned long timeout_ms = 0) {
+		return signal_t{name, timeout_ms, nullptr};
+	}
+
+	/**
+	 * @brief Gets whether the frame could be allocated
+	 *
+	 * @return false if the pool was exhausted or the frame too large
+	 */
+	bool isValid() const { return (bool)_handle; }
+
+	/**
+	 * @brief Gets whether the coroutine has returned
+	 */
+	bool done() const { return !_handle || _handle.done(); }
+
+	/**
+	 * @brief Gets the chain that resumes the coroutine. Add it to a
+	 * dispatcher before starting it
+	 *
+	 * pre: isValid() == true
+	 */
+	EspEventChain &getChain() { return _handle.promise().chain; }
+
+	/**
+	 * @brief Runs the coroutine up to its first co_await, then on
+	 *
+	 * pre: isValid() == true, getChain() is added to a dispatcher
+	 */
+	void start() { getChain().start(); }
+
+  private:
+	/**
+	 * @brief Context callback of every event of the chain, resumes the
+	 * coroutine and points the chain at the wait it asked for
+	 */
+	static void step(EspEventContext &context);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,260 @@
+#include "EspEventDispatcher.h"
+#include "EspEventChain.h"
+#include "EspEventTrace.h"
+
+/**
+ * Heap ordering, true if a should run after b. Deadlines are compared by
+ * their difference so the order survives millis() wrapping around, and ties
+ * go to the higher priority
+ */
+static bool runsAfter(const EspEventDispatcher::entry_t &a,
+					  const EspEventDispatcher::entry_t &b) {
+	const long diff = (long)(a.deadline - b.deadline);
+	if (diff != 0) return diff > 0;
+	if (a.priority != b.priority) return a.priority < b.priority;
+	return (int32_t)(a.sequence - b.sequence) > 0;
+}
+
+EspEventDispatcher::EspEventDispatcher()
+	: _sequence(0), _trace(nullptr), _shedThreshold(0), _shed(0),
+	  _admission(false), _rejected(0), _unanalyzed(0), _isrHead(0),
+	  _isrTail(0), _isrOverflow(false), _wakeHook(nullptr),
+	  _wakeArg(nullptr) {
+	for (std::atomic<EspEventChain *> &slot : _isrQueue) slot = nullptr;
+}
+
+EspEventDispatcher::~EspEventDispatcher() {
+	while (!_chains.empty()) remove(*_chains.back());
+}
+
+void EspEventDispatcher::add(EspEventChain &chain) {
+	if (chain._dispatcher == this) return;
+	if (chain._dispatcher) chain._dispatcher->remove(chain);
+
+	chain.stop();
+	chain._dispatcher = this;
+	chain._isrHandled = chain._isrCount.load(std::memory_order_acquire);
+	chain._isrPosted = false;
+	_chains.push_back(&chain);
+}
+
+void EspEventDispatcher::remove(EspEventChain &chain) {
+	if (chain._dispatcher != this) return;
+
+	chain.stop();
+	chain._dispatcher = nullptr;
+	_chains.erase(std::remove(_chains.begin(), _chains.end(), &chain),
+				  _chains.end());
+
+	// The interrupt queue must not hold the chain either, and requests of
+	// the chain are skipped now that it has no dispatcher
+	serviceISRRequests();
+
+	// Entries must not outlive the chain they point to
+	_queue.erase(std::remove_if(_queue.begin(), _queue.end(),
+								[&](const entry_t &entry) {
+									return entry.chain == &chain;
+								}),
+				 _queue.end());
+	std::make_heap(_queue.begin(), _queue.end(), runsAfter);
+}
+
+void __ESP_EVENT_ISR_ATTR__
+EspEventDispatcher::postFromISR(EspEventChain &chain) {
+	// Requests of a chain are coalesced, so it is queued at most once. The
+	// dispatcher clears the flag before it reads the request, and the chain
+	// stored the request before reading the flag, so one of them sees the
+	// other
+	if (!chain._isrPosted.load()) {
+		chain._isrPosted.store(true, std::memory_order_relaxed);
+		uint32_t slot = _isrHead.load(std::memory_order_relaxed);
+		bool claimed = false;
+		while (slot - _isrTail.load(std::memory_order_acquire) <
+			   __ESP_EVENT_ISR_QUEUE_SIZE__) {
+			if ((claimed = claimFromISR(slot))) break;
+		}
+		if (claimed) {
+			_isrQueue[slot % __ESP_EVENT_ISR_QUEUE_SIZE__].store(
+				&chain, std::memory_order_release);
+		} else {
+			chain._isrPosted.store(false, std::memory_order_relaxed);
+			_isrOverflow.store(true, std::memory_order_release);
+		}
+	}
+	const wake_hook_t hook = _wakeHook;
+	if (hook) hook(_wakeArg);
+}
+
+bool __ESP_EVENT_ISR_ATTR__ EspEventDispatcher::claimFromISR(uint32_t &slot) {
+#ifdef ESP8266
+	// No atomic read-modify-write, but masking interrupts suffices on a
+	// single core
+	const uint32_t level = xt_rsil(15);
+	const uint32_t head = _isrHead.load(std::memory_order_relaxed);
+	if (head == slot) _isrHead.store(head + 1, std::memory_order_relaxed);
+	xt_wsr_ps(level);
+	if (head == slot) return true;
+	slot = head;
+	return false;
+#else
+	return _isrHead.compare_exchange_weak(slot, slot + 1,
+										  std::memory_order_relaxed);
+#endif
+}
+
+bool EspEventDispatcher::empty() {
+	prune();
+	return _queue.empty();
+}
+
+unsigned long EspEventDispatcher::nextDeadline() {
+	prune();
+	return _queue.front().deadline;
+}
+
+EspEventChain *EspEventDispatcher::peek() {
+	prune();
+	return _queue.empty() ? nullptr : _queue.front().chain;
+}
+
+EspEventChain *EspEventDispatcher::runNext(unsigned long now_ms) {
+	prune();
+	if (_queue.empty() || (long)(_queue.front().deadline - now_ms) > 0) {
+		return nullptr;
+	}
+
+	const entry_t entry = pop();
+	EspEventChain &chain = *entry.chain;
+
+#if __ESP_EVENT_TRACE__
+	EspEventTraceRecord record;
+	if (_trace) {
+		record.scheduled_ms = chain._deadline;
+		record.chain_id = chain._id;
+		record.index = chain._currentEvent;
+		record.start_us = EspEventClock::nowMicros();
+	}
+#endif
+
+	const bool more = chain.dispatch(now_ms);
+
+#if __ESP_EVENT_TRACE__
+	if (_trace) {
+		record.end_us = EspEventClock::nowMicros();
+		_trace->record(record);
+	}
+#endif
+
+	if (!more) {
+		chain.finish();
+		chain.complete();
+	} else if (isCurrent(entry) && !chain.waitsForSignal()) {
+		// The callback did not stop or restart the chain, so requeue it
+		push({chain._deadline, _sequence++, entry.generation, &chain,
+			  chain.pendingPriority()});
+	}
+	return &chain;
+}
+
+size_t EspEventDispatcher::runDue(unsigned long now_ms) {
+	serviceISRRequests();
+	size_t count = 0;
+	while (runNext(now_ms)) count++;
+	return count;
+}
+
+size_t EspEventDispatcher::runDue() { return runDue(EspEventClock::now()); }
+
+size_t EspEventDispatcher::raise(const char *signal) {
+	__ESP_EVENT_CHECK__(signal, return 0, "Null pointer exception!");
+	const unsigned long now_ms = EspEventClock::now();
+	size_t count = 0;
+	for (size_t i = 0; i < _chains.size(); i++) {
+		if (_chains[i]->resumeOn(signal, now_ms)) count++;
+	}
+	__ESP_EVENT_LOGD__("Raised %s, %i chains resumed", signal, count);
+	return count;
+}
+
+void EspEventDispatcher::schedule(EspEventChain &chain) {
+	// Queued once the signal it waits for is raised
+	if (chain.waitsForSignal()) return;
+	push({chain._deadline, _sequence++, chain._generation, &chain,
+		  chain.pendingPriority()});
+}
+
+bool EspEventDispatcher::admits(const EspEventChain &chain) {
+	if (!_admission) return true;
+
+	// A chain being restarted is already running, and counted once
+	_analysis.clear();
+	for (const EspEventChain *other : _chains) {
+		if (other != &chain && other->isRunning()) _analysis.add(*other);
+	}
+	_analysis.add(chain);
+
+	// Most sets are decided by the linear tests
+	if (_analysis.checkBound()) return true;
+	if (_analysis.getUtilization() < 1.0f) {
+		if (_analysis.numSteps() > __ESP_EVENT_ADMISSION_MAX_STEPS__) {
+			_unanalyzed++;
+			__ESP_EVENT_LOGW__("Starting chain %i unanalyzed, %i steps are "
+							   "too many to analyze",
+							   chain.getId(), _analysis.numSteps());
+			return true;
+		}
+		if (_analysis.analyze()) return true;
+	}
+
+	_rejected++;
+	__ESP_EVENT_LOGW__("Not starting chain %i, utilization would be %f",
+					   chain.getId(), _analysis.getUtilization());
+	return false;
+}
+
+void EspEventDispatcher::prune() {
+	while (!_queue.empty() && !isCurrent(_queue.front())) pop();
+}
+
+void EspEventDispatcher::serviceISRRequests() {
+	uint32_t tail = _isrTail.load(std::memory_order_relaxed);
+	const bool overflow = _isrOverflow.load(std::memory_order_acquire);
+	if (tail == _isrHead.load(std::memory_order_acquire) && !overflow) return;
+
+	// Only the chains that made a request are visited
+	const unsigned long now_ms = EspEventClock::now();
+	while (tail != _isrHead.load(std::memory_order_acquire)) {
+		std::atomic<EspEventChain *> &slot =
+			_isrQueue[tail % __ESP_EVENT_ISR_QUEUE_SIZE__];
+		EspEventChain *const chain = slot.load(std::memory_order_acquire);
+		// Claimed but not yet filled, its interrupt wakes the backend after
+		if (!chain) break;
+		slot.store(nullptr, std::memory_order_relaxed);
+		_isrTail.store(++tail, std::memory_order_release);
+		chain->_isrPosted.store(false);
+		if (chain->_dispatcher == this) chain->serviceISRRequest(now_ms);
+	}
+
+	if (!overflow) return;
+	_isrOverflow.store(false);
+	for (size_t i = 0; i < _chains.size(); i++) {
+		_chains[i]->serviceISRRequest(now_ms);
+	}
+}
+
+void EspEventDispatcher::push(const entry_t &entry) {
+	_queue.push_back(entry);
+	std::push_heap(_queue.begin(), _queue.end(), runsAfter);
+}
+
+EspEventDispatcher::entry_t EspEventDispatcher::pop() {
+	std::pop_heap(_queue.begin(), _queue.end(), runsAfter);
+	const entry_t entry = _queue.back();
+	_queue.pop_back();
+	return entry;
+}
+
+bool EspEventDispatcher::isCurrent(const entry_t &entry) const {
+	return entry.chain->_started &&
+		   entry.chain->_generation == entry.generation;
+}
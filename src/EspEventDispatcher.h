@@ -0,0 +1,354 @@
+/**
+ * @file EspEventDispatcher.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Runs any number of EspEventChains from a single queue of deadlines, so
+ * that one task, loop() or host thread can drive every chain
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_DISPATCHER_H__
+#define __ESP_EVENT_DISPATCHER_H__
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "EspEventAnalysis.h"
+
+// Most steps admission control analyzes exactly, as the analysis takes time
+// growing faster than the cube of the step count. Larger sets that the
+// linear tests cannot decide are admitted without it
+#ifndef __ESP_EVENT_ADMISSION_MAX_STEPS__
+#define __ESP_EVENT_ADMISSION_MAX_STEPS__ 32
+#endif
+
+// Places the functions called from interrupts in IRAM, so they run while
+// the flash cache is disabled
+#if defined(ESP32)
+#define __ESP_EVENT_ISR_ATTR__ IRAM_ATTR
+#elif defined(ESP8266)
+#define __ESP_EVENT_ISR_ATTR__ ICACHE_RAM_ATTR
+#else
+#define __ESP_EVENT_ISR_ATTR__
+#endif
+
+// Chains that can wait in the queue of interrupt requests. Once it is full,
+// requests are still handled but every chain is checked for them
+#ifndef __ESP_EVENT_ISR_QUEUE_SIZE__
+#define __ESP_EVENT_ISR_QUEUE_SIZE__ 16
+#endif
+
+class EspEventChain;
+class EspEventTrace;
+
+/**
+ *
+ * Queue of chains ordered by the deadline of their pending event. Chains
+ * added to a dispatcher are started and stopped as usual, but rather than
+ * using a Ticker or a task of their own they are run by calls to runDue()
+ *
+ * Events are run earliest deadline first. Events due at the same time run
+ * in order of priority, then in the order they were queued
+ *
+ */
+class EspEventDispatcher {
+	friend class EspEventChain;
+
+  public:
+	struct entry_t {
+		unsigned long deadline;
+		uint32_t sequence;
+		uint32_t generation;
+		EspEventChain *chain;
+		uint8_t priority;
+	};
+
+	// Called from an interrupt after a chain request is stored
+	typedef void (*wake_hook_t)(void *arg);
+
+  private:
+	// Binary heap with the earliest deadline at the front
+	std::vector<entry_t> _queue;
+	std::vector<EspEventChain *> _chains;
+	uint32_t _sequence;
+
+	// Recorder of every event run, if any
+	EspEventTrace *_trace;
+
+	// Lateness past which sheddable events are dropped, 0 to never drop
+	unsigned long _shedThreshold;
+	uint32_t _shed;
+
+	// Whether chains are analyzed before they start, how many were turned
+	// away and how many were let in unanalyzed. The analysis is kept so its
+	// storage is reused
+	bool _admission;
+	uint32_t _rejected;
+	uint32_t _unanalyzed;
+	EspEventAnalysis _analysis;
+
+	// Ring of chains with a request from an interrupt. Interrupts claim a
+	// slot by moving the head and then fill it, the dispatcher empties
+	// slots from the tail, so a slot is null until its chain is written
+	std::atomic<EspEventChain *> _isrQueue[__ESP_EVENT_ISR_QUEUE_SIZE__];
+	std::atomic<uint32_t> _isrHead;
+	std::atomic<uint32_t> _isrTail;
+
+	// Set when a chain found the ring full
+	std::atomic<bool> _isrOverflow;
+	wake_hook_t _wakeHook;
+	void *_wakeArg;
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: empty() == true
+	 */
+	EspEventDispatcher();
+
+	/**
+	 * @brief Destructor, detaches every chain that was added
+	 *
+	 * post: chains revert to their own backend
+	 */
+	~EspEventDispatcher();
+
+	EspEventDispatcher(const EspEventDispatcher &) = delete;
+	EspEventDispatcher &operator=(const EspEventDispatcher &) = delete;
+
+	/**
+	 * @brief Makes this dispatcher the backend of a chain
+	 *
+	 * pre: chain is not running on another backend
+	 *
+	 * post: chain.start() queues the chain here, and it is run by runDue()
+	 */
+	void add(EspEventChain &chain);
+
+	/**
+	 * @brief Detaches a chain and drops its queued event
+	 *
+	 * post: chain.isRunning() == false
+	 */
+	void remove(EspEventChain &chain);
+
+	/**
+	 * @brief Gets the number of chains added to the dispatcher
+	 *
+	 * @return 0 <= numChains()
+	 */
+	size_t numChains() const { return _chains.size(); }
+
+	/**
+	 * @brief Records every event run by the dispatcher into a trace. Only
+	 * has an effect when built with __ESP_EVENT_TRACE__ set
+	 *
+	 * @param trace	The trace to record into, nullptr to stop recording
+	 */
+	void setTrace(EspEventTrace *trace) { _trace = trace; }
+
+	/**
+	 * @brief Gets the trace events are recorded into
+	 *
+	 * @return nullptr if not recording
+	 */
+	EspEventTrace *getTrace() const { return _trace; }
+
+	/**
+	 * @brief Drops sheddable events that come due more than threshold_ms
+	 * late rather than running them, so a dispatcher that fell behind
+	 * catches up instead of running every missed event back to back. A
+	 * dropped event is passed over like one without a callback, but its
+	 * time is kept so the chain stays on schedule
+	 *
+	 * @param threshold_ms	Lateness in milliseconds, 0 to run every event
+	 */
+	void setShedThreshold(unsigned long threshold_ms) {
+		_shedThreshold = threshold_ms;
+	}
+
+	/**
+	 * @brief Gets the lateness past which sheddable events are dropped
+	 *
+	 * @return Time in milliseconds, 0 if events are never dropped
+	 */
+	unsigned long getShedThreshold() const { return _shedThreshold; }
+
+	/**
+	 * @brief Gets the number of events dropped by the dispatcher
+	 */
+	uint32_t getShed() const { return _shed; }
+
+	/**
+	 * @brief Refuses to start a chain if the chains already running and
+	 * that chain together could miss a deadline, going by the costs given
+	 * to their events. See EspEventAnalysis. Off by default
+	 *
+	 * Every start checks the whole running set on the calling thread.
+	 * EspEventAnalysis::checkBound() admits sets well within their
+	 * deadlines and refuses sets at full utilization, in time linear in
+	 * the number of steps. Only the others are analyzed exactly, which
+	 * takes about 0.6 ms for 32 steps and 6 ms for 64 on a desktop and far
+	 * longer on a device. Past __ESP_EVENT_ADMISSION_MAX_STEPS__ steps they
+	 * are admitted unanalyzed instead, and counted by getUnanalyzed(). The
+	 * analysis does not know that the dispatcher sheds late events or that
+	 * overrun policies skip or stop chains, so it takes every event to run
+	 *
+	 * @param enabled	Whether to analyze each chain as it starts
+	 */
+	void setAdmissionControl(bool enabled) { _admission = enabled; }
+
+	/**
+	 * @brief Gets whether chains are analyzed as they start
+	 */
+	bool getAdmissionControl() const { return _admission; }
+
+	/**
+	 * @brief Gets the number of starts refused by admission control
+	 */
+	uint32_t getRejected() const { return _rejected; }
+
+	/**
+	 * @brief Gets the number of starts admission control let through
+	 * because the running set had too many steps to analyze
+	 */
+	uint32_t getUnanalyzed() const { return _unanalyzed; }
+
+	/**
+	 * @brief Sets a function called from the interrupt after a chain
+	 * requests to be started or advanced, so that a backend blocked until
+	 * the next deadline wakes up and handles the request. It must be safe
+	 * to call from an ISR, and placed in IRAM on device
+	 *
+	 * @param hook	The function, nullptr for none
+	 * @param arg	Passed to hook
+	 */
+	void setWakeHook(wake_hook_t hook, void *arg) {
+		_wakeArg = arg;
+		_wakeHook = hook;
+	}
+
+	/**
+	 * @brief Queues a chain that stored a request from an interrupt, unless
+	 * it is queued already, and wakes the backend. Called by the chain
+	 */
+	void postFromISR(EspEventChain &chain);
+
+	/**
+	 * @brief Passes requests made from interrupts to the chains queued for
+	 * them, or to every chain if the queue overflowed. This may start
+	 * chains, so it is done once per runDue() and never by the queries.
+	 * Backends that call runNext() themselves call it once per iteration
+	 */
+	void serviceISRRequests();
+
+	/**
+	 * @brief Gets whether any running chain has a queued event
+	 *
+	 * @return true if no event is queued
+	 */
+	bool empty();
+
+	/**
+	 * @brief Gets the deadline of the earliest queued event
+	 *
+	 * pre: empty() == false
+	 *
+	 * @return EspEventClock time in milliseconds
+	 */
+	unsigned long nextDeadline();
+
+	/**
+	 * @brief Gets the chain whose event will run next
+	 *
+	 * @return nullptr if empty()
+	 */
+	EspEventChain *peek();
+
+	/**
+	 * @brief Runs the earliest queued event if it is due
+	 *
+	 * @param now_ms	The current EspEventClock time
+	 *
+	 * post: the chain is queued again with the deadline of its next event
+	 *
+	 * @return The chain that was run, nullptr if no event was due
+	 */
+	EspEventChain *runNext(unsigned long now_ms);
+
+	/**
+	 * @brief Handles requests made from interrupts, then runs every queued
+	 * event that is due
+	 *
+	 * @param now_ms	The current EspEventClock time
+	 *
+	 * @return The number of events run
+	 */
+	size_t runDue(unsigned long now_ms);
+
+	/**
+	 * @brief Runs every event that is due now. Meant to be called from
+	 * loop() or a task on device
+	 *
+	 * @return The number of events run
+	 */
+	size_t runDue();
+
+	/**
+	 * @brief Raises a signal, so that every chain whose pending event waits
+	 * for it runs that event next. See EspEventChain::setSignalOf(). Called
+	 * from the thread running the dispatcher, usually from a callback
+	 *
+	 * @param signal	Name of the signal, signal != nullptr
+	 *
+	 * @return The number of chains resumed
+	 */
+	size_t raise(const char *signal);
+
+	/**
+	 * @brief Queues a running chain at its current deadline. Called by the
+	 * chain when it is started
+	 */
+	void schedule(EspEventChain &chain);
+
+	/**
+	 * @brief Decides whether a chain may start. Called by the chain before
+	 * it is started
+	 *
+	 * @return true if admission control is off, or the chain and every
+	 * other running chain still meet their deadlines or are too many to
+	 * analyze
+	 */
+	bool admits(const EspEventChain &chain);
+
+  private:
+	/**
+	 * @brief Drops queued entries for chains that were stopped or restarted
+	 * since the entry was queued
+	 *
+	 * post: empty() or the front entry is valid
+	 */
+	void prune();
+
+	/**
+	 * @brief Claims the next slot of the interrupt queue
+	 *
+	 * @param slot	Head the caller saw, updated when another interrupt
+	 * claimed it first
+	 *
+	 * @return true if slot is now the caller's
+	 */
+	bool claimFromISR(uint32_t &slot);
+
+	void push(const entry_t &entry);
+	entry_t pop();
+	bool isCurrent(const entry_t &entry) const;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "EspEventGraph.h"
+
+EspEventGraph::EspEventGraph()
+	: _remaining(0), _runs(0), _failures(0), _doneHook(nullptr),
+	  _doneArg(nullptr),
+	  _validated(false), _running(false) {}
+
+EspEventGraph::~EspEventGraph() { stop(); }
+
+size_t EspEventGraph::add(EspEventChain &chain) {
+	const size_t index = indexOf(chain);
+	if (index < _nodes.size()) return index;
+	if (_running) {
+		__ESP_EVENT_LOGE__("Cannot add a stage while the graph runs");
+		return _nodes.size();
+	}
+
+	node_t node;
+	node.chain = &chain;
+	node.graph = this;
+	node.numDependencies = 0;
+	node.waiting = 0;
+	_nodes.push_back(node);
+	_validated = false;
+	return _nodes.size() - 1;
+}
+
+bool EspEventGraph::addEdge(EspEventChain &before, EspEventChain &after) {
+	if (_running || &before == &after) {
+		__ESP_EVENT_LOGE__("Cannot add edge, graph running or self loop");
+		return false;
+	}
+	const size_t from = add(before);
+	const size_t to = add(after);
+	_nodes[from].dependents.push_back(to);
+	_nodes[to].numDependencies++;
+	_validated = false;
+	return true;
+}
+
+bool EspEventGraph::validate() {
+	// Kahn's algorithm, stages are taken in the order they were added
+	_order.clear();
+	_order.reserve(_nodes.size());
+	for (node_t &node : _nodes) node.waiting = node.numDependencies;
+	for (size_t i = 0; i < _nodes.size(); i++) {
+		if (!_nodes[i].waiting) _order.push_back(i);
+	}
+	for (size_t next = 0; next < _order.size(); next++) {
+		for (size_t dependent : _nodes[_order[next]].dependents) {
+			if (!--_nodes[dependent].waiting) _order.push_back(dependent);
+		}
+	}
+
+	_validated = _order.size() == _nodes.size();
+	if (!_validated) {
+		__ESP_EVENT_LOGE__("Graph has a cycle through %i stages",
+						   _nodes.size() - _order.size());
+		_order.clear();
+	}
+	return _validated;
+}
+
+bool EspEventGraph::start() {
+	if (_running || _nodes.empty()) return false;
+	if (!_validated && !validate()) return false;
+
+	for (node_t &node : _nodes) node.waiting = node.numDependencies;
+	_remaining = _nodes.size();
+	_running = true;
+
+	// Stages that end at once run the rest of the graph from launch()
+	const uint32_t failures = _failures;
+	for (size_t index : _order) {
+		if (!_running || _nodes[index].numDependencies) break;
+		launch(_nodes[index]);
+	}
+	return _failures == failures;
+}
+
+void EspEventGraph::stop() {
+	if (!_running) return;
+	_running = false;
+	for (node_t &node : _nodes) node.chain->stop();
+}
+
+size_t EspEventGraph::indexOf(const EspEventChain &chain) const {
+	for (size_t i = 0; i < _nodes.size(); i++) {
+		if (_nodes[i].chain == &chain) return i;
+	}
+	return _nodes.size();
+}
+
+bool EspEventGraph::launch(node_t &node) {
+	const uint32_t completions = node.chain->getCompletions();
+	EspEventCompletion pass = node.chain->runOnce();
+	if (node.chain->isRunning() ||
+		node.chain->getCompletions() != completions) {
+		// Runs now if the pass is already over
+		pass.then(sComplete, &node);
+		return true;
+	}
+
+	// Its dependents would wait forever, so the run cannot complete
+	__ESP_EVENT_LOGE__("Stopping graph because stage %i did not start",
+					   &node - _nodes.data());
+	_failures++;
+	stop();
+	return false;
+}
+
+void EspEventGraph::sComplete(EspEventChain &, void *arg) {
+	node_t *node = static_cast<node_t *>(arg);
+	node->graph->complete(*node);
+}
+
+void EspEventGraph::complete(node_t &node) {
+	if (!_running) return;
+
+	for (size_t dependent : node.dependents) {
+		node_t &next = _nodes[dependent];
+		if (!--next.waiting) launch(next);
+		if (!_running) return;
+	}
+
+	if (--_remaining) return;
+	_running = false;
+	_runs++;
+	__ESP_EVENT_LOGD__("Graph run %u complete", _runs);
+	if (_doneHook) _doneHook(*this, _doneArg);
+}
@@ -0,0 +1,201 @@
+/**
+ * @file EspEventGraph.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Runs EspEventChains as the stages of a pipeline, each starting once the
+ * stages it depends on complete
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_GRAPH_H__
+#define __ESP_EVENT_GRAPH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "EspEventChain.h"
+
+/**
+ *
+ * Directed acyclic graph of chains. Every chain is run once per run of the
+ * graph, and starts as soon as all of the chains it depends on have
+ * completed, so fan-out and fan-in stages need no flags or polling
+ *
+ * 		EspEventGraph graph;
+ * 		graph.addEdge(warmUp, sampleA);
+ * 		graph.addEdge(warmUp, sampleB);
+ * 		graph.addEdge(sampleA, aggregate);
+ * 		graph.addEdge(sampleB, aggregate);
+ * 		graph.addEdge(aggregate, transmit);
+ * 		graph.start();
+ *
+ * Stages are started from the hook of the pass they wait for, given with
+ * EspEventCompletion::then(), so completion hooks set on the chains keep
+ * running after each pass. A stage that refuses to start,
+ * such as one turned away by admission control, stops the run and is
+ * counted by getFailures(). Chains must outlive the graph, and the graph
+ * must not be modified while it runs
+ *
+ */
+class EspEventGraph {
+
+  public:
+	// Called once every chain of a run has completed
+	typedef void (*done_hook_t)(EspEventGraph &graph, void *arg);
+
+  private:
+	struct node_t {
+		EspEventChain *chain;
+		EspEventGraph *graph;
+		std::vector<size_t> dependents;
+		size_t numDependencies;
+		size_t waiting;
+	};
+
+	std::vector<node_t> _nodes;
+
+	// Nodes in topological order, empty until validate() succeeds
+	std::vector<size_t> _order;
+
+	size_t _remaining;
+	uint32_t _runs;
+	uint32_t _failures;
+	done_hook_t _doneHook;
+	void *_doneArg;
+
+	bool _validated : 1;
+	bool _running : 1;
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: numNodes() == 0
+	 */
+	EspEventGraph();
+
+	/**
+	 * @brief Destructor, stops a run in progress
+	 */
+	~EspEventGraph();
+
+	EspEventGraph(const EspEventGraph &) = delete;
+	EspEventGraph &operator=(const EspEventGraph &) = delete;
+
+	/**
+	 * @brief Adds a chain as a stage with no dependencies yet
+	 *
+	 * @return The position of the stage, the existing one if chain was
+	 * already added
+	 */
+	size_t add(EspEventChain &chain);
+
+	/**
+	 * @brief Makes one stage wait for another, adding either if needed
+	 *
+	 * @param before	The stage that completes first
+	 * @param after		The stage started once every stage before it has
+	 * completed
+	 *
+	 * @return false if the graph is running or before == after
+	 */
+	bool addEdge(EspEventChain &before, EspEventChain &after);
+
+	/**
+	 * @brief Orders the stages so each comes after the stages it depends on
+	 *
+	 * post: getOrdered() lists the stages in topological order
+	 *
+	 * @return false if the dependencies form a cycle
+	 */
+	bool validate();
+
+	/**
+	 * @brief Starts every stage with no dependencies, the others follow as
+	 * they become ready. Validates the graph first if it changed
+	 *
+	 * @return false if the graph is empty, running or has a cycle, or a
+	 * stage did not start
+	 */
+	bool start();
+
+	/**
+	 * @brief Stops every stage, abandoning the run
+	 *
+	 * post: isRunning() == false
+	 */
+	void stop();
+
+	/**
+	 * @brief Gets whether a run is in progress
+	 */
+	bool isRunning() const { return _running; }
+
+	/**
+	 * @brief Gets the number of runs in which every stage completed
+	 */
+	uint32_t getRuns() const { return _runs; }
+
+	/**
+	 * @brief Gets the number of runs stopped because a stage did not start
+	 */
+	uint32_t getFailures() const { return _failures; }
+
+	/**
+	 * @brief Gets the number of stages
+	 */
+	size_t numNodes() const { return _nodes.size(); }
+
+	/**
+	 * @brief Gets a stage in topological order
+	 *
+	 * pre: validate() == true
+	 *
+	 * @param pos	0 <= pos < numNodes()
+	 */
+	EspEventChain &getOrdered(size_t pos) const {
+		return *_nodes[_order[pos]].chain;
+	}
+
+	/**
+	 * @brief Sets a function to call when every stage of a run has
+	 * completed. It may start the graph again
+	 *
+	 * @param hook	The function, nullptr for none
+	 * @param arg	Passed to hook
+	 */
+	void setDoneHook(done_hook_t hook, void *arg = nullptr) {
+		_doneArg = arg;
+		_doneHook = hook;
+	}
+
+  private:
+	/**
+	 * @brief Gets the position of a stage
+	 *
+	 * @return numNodes() if chain was not added
+	 */
+	size_t indexOf(const EspEventChain &chain) const;
+
+	/**
+	 * @brief Starts a stage for one pass, stopping the graph if it refuses.
+	 * A pass that ends within runOnce(), as on ESP8266 when its events are
+	 * all due, has started
+	 *
+	 * @return false if the stage did not start
+	 */
+	bool launch(node_t &node);
+
+	/**
+	 * @brief Hook of the pass of every stage, starts the stages that were
+	 * waiting only for it
+	 */
+	static void sComplete(EspEventChain &, void *arg);
+	void complete(node_t &node);
+};
+
+#endif
@@ -0,0 +1,25 @@
+#include "EspEventHost.h"
+
+#ifndef ARDUINO
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static char sLastLog[256] = "";
+static size_t sLogCount = 0;
+
+void espEventHostLog(char level, const char *tag, const char *format, ...) {
+	const int prefix = snprintf(sLastLog, sizeof(sLastLog), "%c (%s) ", level,
+								tag);
+	va_list args;
+	va_start(args, format);
+	vsnprintf(sLastLog + prefix, sizeof(sLastLog) - prefix, format, args);
+	va_end(args);
+	sLogCount++;
+}
+
+size_t espEventHostLogCount() { return sLogCount; }
+
+const char *espEventHostLastLog() { return sLastLog; }
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file EspEventHost.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Stand-ins for the Arduino / EspDebug facilities used by EspEventChain so
+ * the library can be built and tested on a host machine
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_HOST_H__
+#define __ESP_EVENT_HOST_H__
+
+#ifndef ARDUINO
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <stddef.h>
+
+// Messages are formatted as on device but kept rather than printed, so tests
+// stay quiet and can count them
+#ifndef ESP_LOGE
+#define ESP_LOGE(tag, ...) espEventHostLog('E', tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) espEventHostLog('W', tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) espEventHostLog('I', tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) espEventHostLog('D', tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) espEventHostLog('V', tag, __VA_ARGS__)
+#endif
+
+/**
+ * @brief Formats a log message into the host log buffer
+ *
+ * @param level		One of 'E', 'W', 'I', 'D', 'V'
+ */
+void espEventHostLog(char level, const char *tag, const char *format, ...);
+
+/**
+ * @brief Gets the number of messages logged since the program started
+ */
+size_t espEventHostLogCount();
+
+/**
+ * @brief Gets the most recent message
+ *
+ * @return "" if nothing was logged
+ */
+const char *espEventHostLastLog();
+
+inline void panic() { abort(); }
+
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+#include "EspEventLinuxLoop.h"
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "EspEventChain.h"
+
+#define __ESP_EVENT_LINUX_LOOP_MAX_EVENTS__ 2
+
+EspEventLinuxLoop::EspEventLinuxLoop()
+	: _armed(0), _wakeups(0), _events(0), _stopRequested(false),
+	  _isArmed(false) {
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+	_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (!isValid()) {
+		__ESP_EVENT_LOGE__("Could not open descriptors: %s", strerror(errno));
+		return;
+	}
+
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = _timer;
+	bool watched = epoll_ctl(_epoll, EPOLL_CTL_ADD, _timer, &event) == 0;
+	event.data.fd = _wake;
+	watched = watched && epoll_ctl(_epoll, EPOLL_CTL_ADD, _wake, &event) == 0;
+	if (!watched) {
+		// Without both descriptors the loop could sleep forever
+		__ESP_EVENT_LOGE__("Could not watch descriptors: %s", strerror(errno));
+		close(_epoll);
+		_epoll = -1;
+		return;
+	}
+
+	// Chains triggered from a signal handler or another thread wake the loop
+	_dispatcher.setWakeHook(sWake, this);
+}
+
+EspEventLinuxLoop::~EspEventLinuxLoop() {
+	// Chains are detached by the dispatcher before the descriptors close
+	if (_wake >= 0) close(_wake);
+	if (_timer >= 0) close(_timer);
+	if (_epoll >= 0) close(_epoll);
+}
+
+int EspEventLinuxLoop::poll(int timeout_ms) {
+	if (!isValid() || !arm()) return -1;
+
+	struct epoll_event ready[__ESP_EVENT_LINUX_LOOP_MAX_EVENTS__];
+	const int n = epoll_wait(_epoll, ready,
+							 __ESP_EVENT_LINUX_LOOP_MAX_EVENTS__, timeout_ms);
+	if (n < 0) {
+		if (errno == EINTR) return 0;
+		__ESP_EVENT_LOGE__("epoll_wait failed: %s", strerror(errno));
+		return -1;
+	}
+
+	uint64_t count;
+	for (int i = 0; i < n; i++) {
+		if (ready[i].data.fd == _timer) {
+			if (read(_timer, &count, sizeof(count)) > 0) _wakeups++;
+			_isArmed = false;
+		}
+		else if (read(_wake, &count, sizeof(count)) < 0) {
+			__ESP_EVENT_LOGW__("Could not clear wake descriptor");
+		}
+	}
+
+	const size_t ran = _dispatcher.runDue(EspEventClock::now());
+	_events += ran;
+	return ran;
+}
+
+bool EspEventLinuxLoop::run() {
+	_stopRequested = false;
+	while (!_stopRequested.load(std::memory_order_relaxed)) {
+		if (poll() < 0) return false;
+	}
+	return true;
+}
+
+void EspEventLinuxLoop::stop() {
+	_stopRequested = true;
+	wake();
+}
+
+void EspEventLinuxLoop::wake() {
+	const uint64_t one = 1;
+	if (write(_wake, &one, sizeof(one)) < 0) {
+		__ESP_EVENT_LOGW__("Could not wake loop");
+	}
+}
+
+void EspEventLinuxLoop::sWake(void *arg) {
+	static_cast<EspEventLinuxLoop *>(arg)->wake();
+}
+
+bool EspEventLinuxLoop::arm() {
+	struct itimerspec spec = {};
+
+	if (_dispatcher.empty()) {
+		if (!_isArmed) return true;
+		_isArmed = false;
+		return timerfd_settime(_timer, 0, &spec, nullptr) == 0;
+	}
+
+	const unsigned long deadline = _dispatcher.nextDeadline();
+	if (_isArmed && deadline == _armed) return true;
+
+	// The deadline wraps along with EspEventClock, so only the time left is
+	// taken from it and added to the full CLOCK_MONOTONIC time. That is
+	// never all zero, which would disarm the timer
+	const long left = (long)(deadline - EspEventClock::now());
+	if (clock_gettime(CLOCK_MONOTONIC, &spec.it_value) != 0) {
+		__ESP_EVENT_LOGE__("clock_gettime failed: %s", strerror(errno));
+		return false;
+	}
+	if (left > 0) {
+		spec.it_value.tv_sec += left / 1000;
+		spec.it_value.tv_nsec += (left % 1000) * 1000000;
+		if (spec.it_value.tv_nsec >= 1000000000) {
+			spec.it_value.tv_sec++;
+			spec.it_value.tv_nsec -= 1000000000;
+		}
+	}
+	if (timerfd_settime(_timer, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+		__ESP_EVENT_LOGE__("timerfd_settime failed: %s", strerror(errno));
+		return false;
+	}
+	_armed = deadline;
+	_isArmed = true;
+	return true;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * @file EspEventLinuxLoop.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Linux backend that runs every chain of a dispatcher from one epoll loop
+ * and a single timerfd
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_LINUX_LOOP_H__
+#define __ESP_EVENT_LINUX_LOOP_H__
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "EspEventDispatcher.h"
+
+/**
+ *
+ * Event loop for running chains in a Linux process. The timerfd is armed
+ * with the absolute CLOCK_MONOTONIC deadline of the earliest queued event,
+ * so the thread calling run() only wakes when an event is due, no matter
+ * how many chains are added. The deadline is worked out from the time left
+ * before the event, so it stays right when EspEventClock wraps
+ *
+ * Chains must be started, stopped and modified from the thread calling
+ * run(), usually from inside a callback. Only stop(), triggerFromISR() and
+ * advanceFromISR() may be called from another thread or a signal handler
+ *
+ */
+class EspEventLinuxLoop {
+
+	EspEventDispatcher _dispatcher;
+	int _epoll, _timer, _wake;
+	unsigned long _armed;
+	uint64_t _wakeups, _events;
+	std::atomic<bool> _stopRequested;
+	bool _isArmed : 1;
+
+  public:
+	/**
+	 * @brief Default constructor, opens the epoll, timer and wake descriptors
+	 *
+	 * post: isValid() == true unless a descriptor could not be opened or
+	 * watched
+	 */
+	EspEventLinuxLoop();
+
+	/**
+	 * @brief Destructor, detaches every chain and closes the descriptors
+	 */
+	~EspEventLinuxLoop();
+
+	EspEventLinuxLoop(const EspEventLinuxLoop &) = delete;
+	EspEventLinuxLoop &operator=(const EspEventLinuxLoop &) = delete;
+
+	/**
+	 * @brief Gets whether the descriptors were opened and are watched
+	 *
+	 * @return false if run() and poll() cannot be used
+	 */
+	bool isValid() const { return _epoll >= 0 && _timer >= 0 && _wake >= 0; }
+
+	/**
+	 * @brief Makes this loop the backend of a chain
+	 *
+	 * post: chain.start() queues the chain here
+	 */
+	void add(EspEventChain &chain) { _dispatcher.add(chain); }
+
+	/**
+	 * @brief Detaches a chain
+	 *
+	 * post: chain.isRunning() == false
+	 */
+	void remove(EspEventChain &chain) { _dispatcher.remove(chain); }
+
+	/**
+	 * @brief Waits for the next event and runs every event that is due
+	 *
+	 * @param timeout_ms	Longest time to wait, -1 to wait for an event
+	 *
+	 * @return The number of events run, -1 on error
+	 */
+	int poll(int timeout_ms = -1);
+
+	/**
+	 * @brief Runs events until stop() is called
+	 *
+	 * @return false if the loop exited because of an error
+	 */
+	bool run();
+
+	/**
+	 * @brief Makes run() return once the current events finish. Safe to
+	 * call from any thread or a signal handler
+	 */
+	void stop();
+
+	/**
+	 * @brief Gets the epoll descriptor, which becomes readable when an event
+	 * is due. Used to nest this loop in another event loop that calls
+	 * poll(0)
+	 */
+	int getFd() const { return _epoll; }
+
+	/**
+	 * @brief Gets the dispatcher holding the chains
+	 */
+	EspEventDispatcher &getDispatcher() { return _dispatcher; }
+
+	/**
+	 * @brief Gets the number of times the timer woke the loop
+	 */
+	uint64_t getWakeups() const { return _wakeups; }
+
+	/**
+	 * @brief Gets the number of events run by the loop
+	 */
+	uint64_t getEvents() const { return _events; }
+
+  private:
+	/**
+	 * @brief Arms the timer for the earliest queued deadline, or disarms it
+	 * if no chain is running. Skips the syscall if the deadline is unchanged
+	 *
+	 * @return false on error
+	 */
+	bool arm();
+
+	/**
+	 * @brief Makes a blocked poll() return, safe from a signal handler
+	 */
+	void wake();
+
+	/**
+	 * @brief Wake hook of the dispatcher, arg is the loop
+	 */
+	static void sWake(void *arg);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file EspEventLog.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Compile time log levels for the library. Messages above
+ * __ESP_EVENT_LOG_LEVEL__ are removed along with their arguments, so logging
+ * costs nothing on the hot paths unless it is enabled
+ *
+ * Build flags:
+ *
+ *   -D__ESP_EVENT_LOG_LEVEL__=4        Keep messages up to debug
+ *   -D__ESP_EVENT_LOG_RATE_MS__=1000   Print each info / debug / verbose
+ *                                      message at most once a second
+ *
+ */
+
+#ifndef __ESP_EVENT_LOG_H__
+#define __ESP_EVENT_LOG_H__
+
+#define __ESP_EVENT_LOG_NONE__ 0
+#define __ESP_EVENT_LOG_ERROR__ 1
+#define __ESP_EVENT_LOG_WARN__ 2
+#define __ESP_EVENT_LOG_INFO__ 3
+#define __ESP_EVENT_LOG_DEBUG__ 4
+#define __ESP_EVENT_LOG_VERBOSE__ 5
+
+// Errors and warnings are kept by default
+#ifndef __ESP_EVENT_LOG_LEVEL__
+#define __ESP_EVENT_LOG_LEVEL__ __ESP_EVENT_LOG_WARN__
+#endif
+
+// Minimum time between two prints of the same message, 0 to print all
+#ifndef __ESP_EVENT_LOG_RATE_MS__
+#define __ESP_EVENT_LOG_RATE_MS__ 0
+#endif
+
+#define __ESP_EVENT_CHAIN_DEBUG_TAG__ "*EspEvent"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "EspDebug.h"
+#else
+#include "EspEventHost.h"
+#endif
+
+#include "EspEventClock.h"
+
+#define __ESP_EVENT_LOG_OFF__(...) ((void)0)
+
+#if __ESP_EVENT_LOG_RATE_MS__ > 0
+// Each call site remembers when it last printed
+#define __ESP_EVENT_LOG_LIMITED__(log, ...)                                    \
+	do {                                                                       \
+		static unsigned long __last_ms = 0;                                    \
+		static bool __printed = false;                                         \
+		const unsigned long __now_ms = EspEventClock::now();                   \
+		if (!__printed || __now_ms - __last_ms >= __ESP_EVENT_LOG_RATE_MS__) { \
+			__printed = true;                                                  \
+			__last_ms = __now_ms;                                              \
+			log(__ESP_EVENT_CHAIN_DEBUG_TAG__, __VA_ARGS__);                   \
+		}                                                                      \
+	} while (0)
+#else
+#define __ESP_EVENT_LOG_LIMITED__(log, ...)                                    \
+	log(__ESP_EVENT_CHAIN_DEBUG_TAG__, __VA_ARGS__)
+#endif
+
+#if __ESP_EVENT_LOG_LEVEL__ >= __ESP_EVENT_LOG_ERROR__
+#define __ESP_EVENT_LOGE__(...)                                                \
+	ESP_LOGE(__ESP_EVENT_CHAIN_DEBUG_TAG__, __VA_ARGS__)
+#else
+#define __ESP_EVENT_LOGE__ __ESP_EVENT_LOG_OFF__
+#endif
+
+#if __ESP_EVENT_LOG_LEVEL__ >= __ESP_EVENT_LOG_WARN__
+#define __ESP_EVENT_LOGW__(...)                                                \
+	ESP_LOGW(__ESP_EVENT_CHAIN_DEBUG_TAG__, __VA_ARGS__)
+#else
+#define __ESP_EVENT_LOGW__ __ESP_EVENT_LOG_OFF__
+#endif
+
+#if __ESP_EVENT_LOG_LEVEL__ >= __ESP_EVENT_LOG_INFO__
+#define __ESP_EVENT_LOGI__(...) __ESP_EVENT_LOG_LIMITED__(ESP_LOGI, __VA_ARGS__)
+#else
+#define __ESP_EVENT_LOGI__ __ESP_EVENT_LOG_OFF__
+#endif
+
+#if __ESP_EVENT_LOG_LEVEL__ >= __ESP_EVENT_LOG_DEBUG__
+#define __ESP_EVENT_LOGD__(...) __ESP_EVENT_LOG_LIMITED__(ESP_LOGD, __VA_ARGS__)
+#else
+#define __ESP_EVENT_LOGD__ __ESP_EVENT_LOG_OFF__
+#endif
+
+#if __ESP_EVENT_LOG_LEVEL__ >= __ESP_EVENT_LOG_VERBOSE__
+#define __ESP_EVENT_LOGV__(...) __ESP_EVENT_LOG_LIMITED__(ESP_LOGV, __VA_ARGS__)
+#else
+#define __ESP_EVENT_LOGV__ __ESP_EVENT_LOG_OFF__
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+#include "EspEventRegistry.h"
+
+EspEventRegistry::function_t
+	EspEventRegistry::_functions[__ESP_EVENT_REGISTRY_SIZE__];
+const char *EspEventRegistry::_names[__ESP_EVENT_REGISTRY_SIZE__];
+EspEventRegistry::id_t EspEventRegistry::_size = 0;
+
+EspEventRegistry::id_t EspEventRegistry::add(const char *name,
+											  function_t function) {
+	if (name == nullptr || function == nullptr) return INVALID_ID;
+
+	id_t id = find(name);
+	if (id == INVALID_ID) {
+		if (_size >= __ESP_EVENT_REGISTRY_SIZE__) return INVALID_ID;
+		id = _size++;
+	}
+	_names[id] = name;
+	_functions[id] = function;
+	return id;
+}
+
+EspEventRegistry::id_t EspEventRegistry::find(const char *name) {
+	if (name == nullptr) return INVALID_ID;
+	for (id_t id = 0; id < _size; id++) {
+		if (!strcmp(name, _names[id])) return id;
+	}
+	return INVALID_ID;
+}
+
+const char *EspEventRegistry::getName(id_t id) {
+	return contains(id) ? _names[id] : nullptr;
+}
+
+void EspEventRegistry::clear() { _size = 0; }
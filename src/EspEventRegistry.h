@@ -0,0 +1,108 @@
+/**
+ * @file EspEventRegistry.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Global table of named callbacks that events can reference by a small
+ * integer id rather than holding their own callable
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_REGISTRY_H__
+#define __ESP_EVENT_REGISTRY_H__
+
+#ifndef __ESP_EVENT_REGISTRY_SIZE__
+#define __ESP_EVENT_REGISTRY_SIZE__ 32
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ *
+ * Fixed size table of named callbacks. Each callback is a plain function
+ * pointer taking a uint32_t argument, so events that reference the registry
+ * need only store an id and an argument
+ *
+ */
+class EspEventRegistry {
+
+  public:
+	typedef void (*function_t)(uint32_t arg);
+	typedef uint16_t id_t;
+
+	static const id_t INVALID_ID = 0xFFFF;
+
+  private:
+	static function_t _functions[__ESP_EVENT_REGISTRY_SIZE__];
+	static const char *_names[__ESP_EVENT_REGISTRY_SIZE__];
+	static id_t _size;
+
+  public:
+	/**
+	 * @brief Registers a named callback
+	 *
+	 * @param name		A unique name for the callback, name != null
+	 * @param function	The function to run, function != null
+	 *
+	 * post: size()++ if the name was not already registered, otherwise the
+	 * existing entry is replaced
+	 *
+	 * @return The id of the callback, INVALID_ID if the registry is full
+	 */
+	static id_t add(const char *name, function_t function);
+
+	/**
+	 * @brief Looks up the id of a callback by name
+	 *
+	 * @param name	The name given to add(), name != null
+	 *
+	 * @return The id of the callback, INVALID_ID if no match was found
+	 */
+	static id_t find(const char *name);
+
+	/**
+	 * @brief Gets the name of a registered callback
+	 *
+	 * @param id	The callback id, 0 <= id < size()
+	 *
+	 * @return The name given to add(), nullptr if id is not registered
+	 */
+	static const char *getName(id_t id);
+
+	/**
+	 * @brief Gets whether an id refers to a registered callback
+	 *
+	 * @return true if 0 <= id < size()
+	 */
+	static bool contains(id_t id) { return id < _size; }
+
+	/**
+	 * @brief Gets the number of registered callbacks
+	 *
+	 * @return 0 <= size() <= __ESP_EVENT_REGISTRY_SIZE__
+	 */
+	static size_t size() { return _size; }
+
+	/**
+	 * @brief Removes all registered callbacks
+	 *
+	 * post: size() == 0
+	 */
+	static void clear();
+
+	/**
+	 * @brief Runs a registered callback. No bounds checking is done here,
+	 * ids are expected to have been validated when the event was created
+	 *
+	 * @param id	The callback id, contains(id) == true
+	 * @param arg	The argument passed to the callback
+	 */
+	static void call(id_t id, uint32_t arg) { _functions[id](arg); }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "EspEventSimulator.h"
+#include "EspEventChain.h"
+
+EspEventSimulator *EspEventSimulator::_active = nullptr;
+
+EspEventSimulator::EspEventSimulator() : _now_us(0), _start_us(0) {
+	_active = this;
+	EspEventClock::setSource(virtualNow);
+	EspEventClock::setMicroSource(virtualNowMicros);
+	EspEventClock::setChargeHook(virtualCharge);
+}
+
+EspEventSimulator::~EspEventSimulator() {
+	// Chains still attached are detached by the dispatcher, and chains that
+	// were destroyed already removed themselves from it
+	if (_active == this) {
+		_active = nullptr;
+		EspEventClock::setSource(nullptr);
+		EspEventClock::setMicroSource(nullptr);
+		EspEventClock::setChargeHook(nullptr);
+	}
+}
+
+size_t EspEventSimulator::add(EspEventChain &chain) {
+	const size_t index = indexOf(chain);
+	if (index == _chains.size()) {
+		_chains.push_back(&chain);
+		_reports.push_back(report_t());
+	} else if (chain.getDispatcher() == &_dispatcher) {
+		return index;
+	} else {
+		// A destroyed chain was at the same address
+		_reports[index] = report_t();
+	}
+
+	_dispatcher.add(chain);
+	return index;
+}
+
+void EspEventSimulator::remove(EspEventChain &chain) {
+	const size_t index = indexOf(chain);
+	if (index == _chains.size()) return;
+
+	_dispatcher.remove(chain);
+	_chains.erase(_chains.begin() + index);
+	_reports.erase(_reports.begin() + index);
+}
+
+size_t EspEventSimulator::run(unsigned long duration_ms) {
+	const uint64_t end_us = _now_us + (uint64_t)duration_ms * 1000;
+	size_t count = 0;
+
+	for (;;) {
+		// Requests made from interrupts, once per event as on a backend
+		_dispatcher.serviceISRRequests();
+		if (_dispatcher.empty()) break;
+		const uint64_t due_us = (uint64_t)_dispatcher.nextDeadline() * 1000;
+		if (due_us >= end_us) break;
+
+		// Idle until the event is due, or run it late if still busy
+		if (due_us > _now_us) _now_us = due_us;
+		const uint64_t lateness_us = _now_us - due_us;
+
+		// Callbacks are charged their cost by the chain, and may spend more
+		EspEventChain &chain = *_dispatcher.peek();
+		const uint32_t shed = chain.getShed();
+		const uint64_t start_us = _now_us;
+		_dispatcher.runNext(_now_us / 1000);
+		const uint64_t cost_us = _now_us - start_us;
+
+		// The callback may have removed its chain
+		const size_t index = indexOf(chain);
+		if (index == _chains.size()) continue;
+		report_t &report = _reports[index];
+
+		// A dropped event takes no time
+		if (chain.getShed() != shed) {
+			report.shed++;
+			continue;
+		}
+		count++;
+
+		report.events++;
+		report.busy_us += cost_us;
+		report.total_lateness_us += lateness_us;
+		if (lateness_us > 0) report.overlaps++;
+		if (lateness_us > report.max_lateness_us) {
+			report.max_lateness_us = lateness_us;
+		}
+	}
+
+	if (_now_us < end_us) _now_us = end_us;
+	return count;
+}
+
+const EspEventSimulator::report_t &
+EspEventSimulator::getReport(const EspEventChain &chain) const {
+	static const report_t EMPTY = report_t();
+	const size_t index = indexOf(chain);
+	return index < _reports.size() ? _reports[index] : EMPTY;
+}
+
+EspEventSimulator::report_t EspEventSimulator::getTotals() const {
+	report_t totals = report_t();
+	for (const report_t &report : _reports) {
+		totals.events += report.events;
+		totals.shed += report.shed;
+		totals.overlaps += report.overlaps;
+		totals.busy_us += report.busy_us;
+		totals.total_lateness_us += report.total_lateness_us;
+		if (report.max_lateness_us > totals.max_lateness_us) {
+			totals.max_lateness_us = report.max_lateness_us;
+		}
+	}
+	return totals;
+}
+
+float EspEventSimulator::getUtilization() const {
+	const uint64_t elapsed_us = _now_us - _start_us;
+	if (elapsed_us == 0) return 0;
+	return (float)getTotals().busy_us / elapsed_us;
+}
+
+void EspEventSimulator::reset() {
+	for (report_t &report : _reports) report = report_t();
+	_start_us = _now_us;
+}
+
+unsigned long EspEventSimulator::virtualNow() {
+	return _active ? _active->_now_us / 1000 : 0;
+}
+
+unsigned long EspEventSimulator::virtualNowMicros() {
+	return _active ? _active->_now_us : 0;
+}
+
+void EspEventSimulator::virtualCharge(unsigned long us) {
+	if (_active) _active->_now_us += us;
+}
+
+void EspEventSimulator::spend(unsigned long us) { _now_us += us; }
+
+size_t EspEventSimulator::indexOf(const EspEventChain &chain) const {
+	return std::distance(_chains.begin(),
+						 std::find(_chains.begin(), _chains.end(), &chain));
+}
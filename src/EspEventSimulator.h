@@ -0,0 +1,160 @@
+/**
+ * @file EspEventSimulator.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Deterministic discrete-event simulation of a set of EspEventChains, used to
+ * check timing budgets on host before flashing a device
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_SIMULATOR_H__
+#define __ESP_EVENT_SIMULATOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "EspEventDispatcher.h"
+
+class EspEventChain;
+
+/**
+ *
+ * Runs chains on a virtual clock that jumps straight from one event to the
+ * next. Every event is charged the cost declared with
+ * EspEventChain::setCostOf(), during which the simulated CPU is busy and
+ * other events that come due are delayed. The cost is charged through
+ * EspEventClock::charge() while the chain times the callback, so a
+ * callback that spend()s more than its cost counts as an overrun
+ *
+ * While a simulator exists EspEventClock reads its virtual time, so only one
+ * simulator should exist at a time
+ *
+ */
+class EspEventSimulator {
+
+  public:
+	struct report_t {
+		uint32_t events;			// Number of events run
+		uint32_t overlaps;			// Events that came due while busy
+		uint64_t busy_us;			// Total virtual time spent in events
+		uint64_t total_lateness_us; // Sum of lateness over all events
+		uint32_t max_lateness_us;	// Worst lateness of any event
+		uint32_t shed;				// Events dropped by the dispatcher
+	};
+
+  private:
+	EspEventDispatcher _dispatcher;
+	std::vector<EspEventChain *> _chains;
+	std::vector<report_t> _reports;
+	uint64_t _now_us;
+	uint64_t _start_us;
+
+	static EspEventSimulator *_active;
+
+  public:
+	/**
+	 * @brief Constructor, installs the virtual clock
+	 *
+	 * post: EspEventClock::now() == 0
+	 */
+	EspEventSimulator();
+
+	/**
+	 * @brief Destructor, detaches every chain and restores the platform clock
+	 */
+	~EspEventSimulator();
+
+	EspEventSimulator(const EspEventSimulator &) = delete;
+	EspEventSimulator &operator=(const EspEventSimulator &) = delete;
+
+	/**
+	 * @brief Adds a chain to the simulation. The chain is started and
+	 * stopped as usual, but only runs while run() is called
+	 *
+	 * @param chain The chain to simulate, outlives the simulator or is
+	 * removed first
+	 *
+	 * @return The index of the chain's report
+	 */
+	size_t add(EspEventChain &chain);
+
+	/**
+	 * @brief Removes a chain from the simulation
+	 *
+	 * post: chain.isRunning() == false
+	 */
+	void remove(EspEventChain &chain);
+
+	/**
+	 * @brief Advances virtual time, running every event that comes due before
+	 * the end of the period
+	 *
+	 * @param duration_ms	The amount of virtual time to simulate
+	 *
+	 * @return The number of events run
+	 */
+	size_t run(unsigned long duration_ms);
+
+	/**
+	 * @brief Advances virtual time from within a callback, as if it kept the
+	 * CPU busy beyond its declared cost
+	 *
+	 * @param us	Time in microseconds
+	 */
+	void spend(unsigned long us);
+
+	/**
+	 * @brief Gets the virtual time
+	 *
+	 * @return Time in microseconds since the simulator was created
+	 */
+	uint64_t now() const { return _now_us; }
+
+	/**
+	 * @brief Gets the report for a chain
+	 *
+	 * @param chain	A chain given to add()
+	 *
+	 * @return Statistics gathered since the chain was added or reset() was
+	 * called
+	 */
+	const report_t &getReport(const EspEventChain &chain) const;
+
+	/**
+	 * @brief Gets statistics summed over every chain
+	 *
+	 * @return max_lateness_us is the worst over all chains
+	 */
+	report_t getTotals() const;
+
+	/**
+	 * @brief Gets the fraction of simulated time spent running callbacks
+	 *
+	 * @return 0 <= getUtilization(), above 1 if the chains cannot keep up
+	 */
+	float getUtilization() const;
+
+	/**
+	 * @brief Clears every report
+	 *
+	 * post: getTotals() is all zero, utilization measured from now()
+	 */
+	void reset();
+
+	/**
+	 * @brief Gets the dispatcher running the simulated chains
+	 */
+	EspEventDispatcher &getDispatcher() { return _dispatcher; }
+
+  private:
+	static unsigned long virtualNow();
+	static unsigned long virtualNowMicros();
+	static void virtualCharge(unsigned long us);
+	size_t indexOf(const EspEventChain &chain) const;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "EspEventSnapshot.h"
+#include "EspEventChain.h"
+
+#if defined(ESP32)
+#include <sys/time.h>
+#elif defined(ESP8266)
+extern "C" {
+#include <user_interface.h>
+}
+#endif
+
+#ifndef ARDUINO
+// Stand-in for RTC memory, which outlives any one snapshot object
+static uint32_t sRtcMemory[(sizeof(EspEventSnapshotHeader) +
+							sizeof(EspEventSnapshotEntry) *
+								__ESP_EVENT_SNAPSHOT_SIZE__) /
+						   4];
+#elif defined(ESP32)
+RTC_DATA_ATTR static uint32_t sRtcMemory[(sizeof(EspEventSnapshotHeader) +
+										  sizeof(EspEventSnapshotEntry) *
+											  __ESP_EVENT_SNAPSHOT_SIZE__) /
+										 4];
+#endif
+
+EspEventSnapshot::EspEventSnapshot() { clear(); }
+
+bool EspEventSnapshot::capture(uint16_t chain_id, const EspEventChain &chain) {
+	EspEventSnapshotEntry *entry =
+		const_cast<EspEventSnapshotEntry *>(find(chain_id));
+	if (!entry) {
+		if (_header.num_entries == __ESP_EVENT_SNAPSHOT_SIZE__) {
+			__ESP_EVENT_LOGE__("Snapshot full, could not capture chain %i",
+							   chain_id);
+			return false;
+		}
+		entry = &_entries[_header.num_entries++];
+	}
+
+	*entry = EspEventSnapshotEntry();
+	entry->chain_id = chain_id;
+	entry->index = chain._currentEvent;
+	entry->cycles = chain._cycles;
+	if (chain._runOnceFlag) entry->flags |= FLAG_RUN_ONCE;
+	if (chain._started) {
+		entry->flags |= FLAG_RUNNING;
+		entry->time_ms = persistentNow() + chain.getTimeUntilNextEvent();
+	} else if (chain._paused) {
+		entry->flags |= FLAG_PAUSED;
+		entry->time_ms = chain._remaining;
+	}
+	return true;
+}
+
+bool EspEventSnapshot::restore(uint16_t chain_id, EspEventChain &chain) const {
+	const EspEventSnapshotEntry *entry = find(chain_id);
+	if (!entry) return false;
+	if (entry->index >= chain.numEvents()) {
+		__ESP_EVENT_LOGE__(
+			"Snapshot of chain %i does not fit a chain of %i events",
+			chain_id, chain.numEvents());
+		return false;
+	}
+
+	chain.stop();
+	chain._currentEvent = entry->index;
+	chain._cycles = entry->cycles;
+	chain._runOnceFlag = entry->flags & FLAG_RUN_ONCE;
+	if (entry->flags & FLAG_RUNNING) {
+		const uint32_t now = persistentNow();
+		const int32_t left = (int32_t)(entry->time_ms - now);
+		chain._start(left > 0 ? left : 0);
+	} else if (entry->flags & FLAG_PAUSED) {
+		chain._remaining = entry->time_ms;
+		chain._paused = true;
+	}
+	return true;
+}
+
+unsigned long EspEventSnapshot::getSleepDuration() const {
+	const uint32_t now = persistentNow();
+	unsigned long result = (unsigned long)-1;
+	for (size_t i = 0; i < _header.num_entries; i++) {
+		if (!(_entries[i].flags & FLAG_RUNNING)) continue;
+		const int32_t left = (int32_t)(_entries[i].time_ms - now);
+		const unsigned long duration = left > 0 ? left : 0;
+		if (duration < result) result = duration;
+	}
+	return result;
+}
+
+bool EspEventSnapshot::save() const {
+	EspEventSnapshotHeader header = _header;
+	header.checksum = computeChecksum();
+
+	uint32_t buffer[sizeof(*this) / 4];
+	memcpy(buffer, &header, sizeof(header));
+	memcpy(buffer + sizeof(header) / 4, _entries,
+		   sizeof(EspEventSnapshotEntry) * _header.num_entries);
+
+#ifdef ESP8266
+	return ESP.rtcUserMemoryWrite(__ESP_EVENT_SNAPSHOT_RTC_OFFSET__, buffer,
+								  size());
+#else
+	memcpy(sRtcMemory, buffer, size());
+	return true;
+#endif
+}
+
+bool EspEventSnapshot::load() {
+	uint32_t buffer[sizeof(*this) / 4];
+#ifdef ESP8266
+	if (!ESP.rtcUserMemoryRead(__ESP_EVENT_SNAPSHOT_RTC_OFFSET__, buffer,
+							   sizeof(buffer))) {
+		clear();
+		return false;
+	}
+#else
+	memcpy(buffer, sRtcMemory, sizeof(buffer));
+#endif
+
+	memcpy(&_header, buffer, sizeof(_header));
+	if (_header.magic != MAGIC ||
+		_header.num_entries > __ESP_EVENT_SNAPSHOT_SIZE__) {
+		__ESP_EVENT_LOGI__("No snapshot in RTC memory");
+		clear();
+		return false;
+	}
+	memcpy(_entries, buffer + sizeof(_header) / 4,
+		   sizeof(EspEventSnapshotEntry) * _header.num_entries);
+	if (_header.checksum != computeChecksum()) {
+		__ESP_EVENT_LOGW__("Snapshot checksum mismatch");
+		clear();
+		return false;
+	}
+	return true;
+}
+
+void EspEventSnapshot::clear() {
+	_header.magic = MAGIC;
+	_header.num_entries = 0;
+	_header.checksum = 0;
+}
+
+size_t EspEventSnapshot::size() const {
+	return sizeof(EspEventSnapshotHeader) +
+		   sizeof(EspEventSnapshotEntry) * _header.num_entries;
+}
+
+uint32_t EspEventSnapshot::persistentNow() {
+#if defined(ESP32)
+	// The RTC keeps the system time running through deep sleep
+	struct timeval tv;
+	gettimeofday(&tv, nullptr);
+	return (uint32_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#elif defined(ESP8266)
+	// RTC cycles scaled by the calibrated period, in 1/4096 us
+	const uint64_t us =
+		((uint64_t)system_get_rtc_time() * system_rtc_clock_cali_proc()) >> 12;
+	return us / 1000;
+#else
+	return EspEventClock::now();
+#endif
+}
+
+const EspEventSnapshotEntry *EspEventSnapshot::find(uint16_t chain_id) const {
+	for (size_t i = 0; i < _header.num_entries; i++) {
+		if (_entries[i].chain_id == chain_id) return &_entries[i];
+	}
+	return nullptr;
+}
+
+uint32_t EspEventSnapshot::computeChecksum() const {
+	// FNV-1a over the entries and their count
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(_entries);
+	uint32_t hash = 2166136261u ^ _header.num_entries;
+	for (size_t i = 0; i < sizeof(EspEventSnapshotEntry) * _header.num_entries;
+		 i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file EspEventSnapshot.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Compact record of the position and timing of running chains, stored in RTC
+ * memory so chains resume where they were after deep sleep
+ *
+ * Layout (little endian):
+ *
+ *   EspEventSnapshotHeader                     8 bytes
+ *   EspEventSnapshotEntry[num_entries]         16 bytes each
+ *
+ * Deadlines are kept on the persistent clock, which keeps counting through
+ * deep sleep, so the time spent asleep need not be known when restoring
+ *
+ */
+
+#ifndef __ESP_EVENT_SNAPSHOT_H__
+#define __ESP_EVENT_SNAPSHOT_H__
+
+// Most chains a snapshot can hold
+#ifndef __ESP_EVENT_SNAPSHOT_SIZE__
+#define __ESP_EVENT_SNAPSHOT_SIZE__ 8
+#endif
+
+// Offset in 4 byte blocks into ESP8266 user RTC memory
+#ifndef __ESP_EVENT_SNAPSHOT_RTC_OFFSET__
+#define __ESP_EVENT_SNAPSHOT_RTC_OFFSET__ 0
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+class EspEventChain;
+
+/**
+ * Snapshot header, the checksum covers every stored entry
+ */
+struct EspEventSnapshotHeader {
+	uint16_t magic;
+	uint16_t num_entries;
+	uint32_t checksum;
+};
+
+/**
+ * State of one chain
+ */
+struct EspEventSnapshotEntry {
+	uint32_t time_ms; // Persistent clock deadline, time left if paused
+	uint32_t cycles;  // Passes completed through the chain
+	uint16_t chain_id;
+	uint16_t index; // Position of the pending event
+	uint8_t flags;
+	uint8_t reserved[3];
+};
+
+/**
+ *
+ * Holds the state of up to __ESP_EVENT_SNAPSHOT_SIZE__ chains, identified by
+ * an id chosen by the application since chains are rebuilt after waking
+ *
+ * 		snapshot.capture(1, chain);
+ * 		snapshot.save();
+ * 		ESP.deepSleep(snapshot.getSleepDuration() * 1000);
+ *
+ * 		// After waking, with the chain rebuilt
+ * 		if (snapshot.load()) snapshot.restore(1, chain);
+ *
+ */
+class EspEventSnapshot {
+
+  public:
+	static const uint16_t MAGIC = 0x5345; // "ES"
+	static const uint8_t FLAG_RUNNING = 0x01;
+	static const uint8_t FLAG_PAUSED = 0x02;
+	static const uint8_t FLAG_RUN_ONCE = 0x04;
+
+  private:
+	EspEventSnapshotHeader _header;
+	EspEventSnapshotEntry _entries[__ESP_EVENT_SNAPSHOT_SIZE__];
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: numEntries() == 0
+	 */
+	EspEventSnapshot();
+
+	/**
+	 * @brief Records the state of a chain, replacing any entry with the same
+	 * id
+	 *
+	 * @param chain_id	Id used to find the entry when restoring
+	 * @param chain		The chain to record, running, paused or stopped
+	 *
+	 * @return false if the snapshot is full
+	 */
+	bool capture(uint16_t chain_id, const EspEventChain &chain);
+
+	/**
+	 * @brief Returns a chain to its recorded state. A running chain is
+	 * started with its pending event due at the recorded deadline, and runs
+	 * at once if that has passed
+	 *
+	 * @param chain_id	Id given to capture()
+	 * @param chain		The rebuilt chain, with the same events as when
+	 * captured
+	 *
+	 * @return false if there is no entry for chain_id or it does not fit
+	 * the chain
+	 */
+	bool restore(uint16_t chain_id, EspEventChain &chain) const;
+
+	/**
+	 * @brief Gets the time until the earliest pending event of the running
+	 * chains that were captured
+	 *
+	 * @return Time in milliseconds, (unsigned long)-1 if no chain is running
+	 */
+	unsigned long getSleepDuration() const;
+
+	/**
+	 * @brief Writes the snapshot to RTC memory
+	 *
+	 * @return false if the write failed
+	 */
+	bool save() const;
+
+	/**
+	 * @brief Reads the snapshot from RTC memory
+	 *
+	 * post: numEntries() == 0 if no valid snapshot was stored
+	 *
+	 * @return false if RTC memory does not hold a valid snapshot
+	 */
+	bool load();
+
+	/**
+	 * @brief Removes every entry
+	 *
+	 * post: numEntries() == 0
+	 */
+	void clear();
+
+	/**
+	 * @brief Gets the number of chains recorded
+	 */
+	size_t numEntries() const { return _header.num_entries; }
+
+	/**
+	 * @brief Gets the size of the stored snapshot
+	 *
+	 * @return Size in bytes, a multiple of 4
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Gets the clock used for deadlines, which keeps counting through
+	 * deep sleep. This is the RTC on device and EspEventClock on host
+	 *
+	 * @return Time in milliseconds
+	 */
+	static uint32_t persistentNow();
+
+  private:
+	const EspEventSnapshotEntry *find(uint16_t chain_id) const;
+	uint32_t computeChecksum() const;
+};
+
+#endif
@@ -0,0 +1,331 @@
+#include "EspEventTable.h"
+#include "EspEventChain.h"
+
+#if !defined(ARDUINO) && defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Longest callback name that can be resolved from a table
+#define __ESP_EVENT_TABLE_MAX_NAME__ 32
+
+static size_t alignedTo4(size_t size) { return (size + 3) & ~(size_t)3; }
+
+/**
+ *
+ *
+ * 	Reading
+ *
+ */
+
+EspEventTable::EspEventTable() { clear(); }
+
+void EspEventTable::clear() {
+	_data = nullptr;
+	_strings = nullptr;
+	_names = nullptr;
+	_numEvents = 0;
+	_numCallbacks = 0;
+	_stringsSize = 0;
+	_ids.clear();
+}
+
+bool EspEventTable::load(const uint8_t *data, size_t size) {
+	clear();
+	if (data == nullptr || size < sizeof(EspEventTableHeader)) return false;
+
+	EspEventTableHeader header;
+	read(&header, data, sizeof(header));
+	if (header.magic != MAGIC || header.version != VERSION) return false;
+
+	const size_t records_end = sizeof(header) +
+							   header.num_events * sizeof(EspEventRecord);
+	const size_t strings_start =
+		alignedTo4(records_end + header.num_callbacks * sizeof(uint16_t));
+	if (strings_start + header.strings_size > size) return false;
+
+	_data = data;
+	_names = (const uint16_t *)(data + records_end);
+	_strings = (const char *)(data + strings_start);
+	_stringsSize = header.strings_size;
+
+	// Resolve the callback names used by the table against the registry
+	_ids.reserve(header.num_callbacks);
+	for (uint16_t i = 0; i < header.num_callbacks; i++) {
+		uint16_t offset;
+		read(&offset, _names + i, sizeof(offset));
+		if (offset >= _stringsSize) {
+			clear();
+			return false;
+		}
+
+		// Longer names are rejected rather than cut short, as the prefix may
+		// belong to another callback
+		char name[__ESP_EVENT_TABLE_MAX_NAME__] = {0};
+		size_t len = std::min((size_t)(_stringsSize - offset), sizeof(name));
+		read(name, _strings + offset, len);
+		if (memchr(name, '\0', len) == nullptr) {
+			clear();
+			return false;
+		}
+
+		EspEventRegistry::id_t id = EspEventRegistry::find(name);
+		if (id == EspEventRegistry::INVALID_ID) {
+			clear();
+			return false;
+		}
+		_ids.push_back(id);
+	}
+	_numCallbacks = header.num_callbacks;
+	_numEvents = header.num_events;
+
+	// Reject records that point outside of the table
+	for (size_t pos = 0; pos < _numEvents; pos++) {
+		EspEventRecord record = getRecord(pos);
+		if ((record.callback != NO_CALLBACK &&
+			 record.callback >= _numCallbacks) ||
+			(record.handle != NO_HANDLE &&
+			 (record.handle >= _stringsSize || !terminated(record.handle)))) {
+			clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+EspEventRecord EspEventTable::getRecord(size_t pos) const {
+	EspEventRecord record;
+	read(&record,
+		 _data + sizeof(EspEventTableHeader) + pos * sizeof(EspEventRecord),
+		 sizeof(record));
+	return record;
+}
+
+unsigned long EspEventTable::getTimeOf(size_t pos) const {
+	return getRecord(pos).time_ms;
+}
+
+EspEventRegistry::id_t EspEventTable::getCallbackId(size_t pos) const {
+	const uint16_t callback = getRecord(pos).callback;
+	return callback == NO_CALLBACK ? EspEventRegistry::INVALID_ID
+								   : _ids[callback];
+}
+
+const char *EspEventTable::getHandle(size_t pos) const {
+	const uint16_t handle = getRecord(pos).handle;
+	return handle == NO_HANDLE ? "null" : _strings + handle;
+}
+
+int EspEventTable::getPositionFromHandle(const char *handle) const {
+	if (handle == nullptr || !strcmp(handle, "null")) return -1;
+	for (size_t pos = 0; pos < _numEvents; pos++) {
+		const uint16_t offset = getRecord(pos).handle;
+		if (offset != NO_HANDLE && handleEquals(offset, handle)) return pos;
+	}
+	return -1;
+}
+
+EspEvent EspEventTable::getEvent(size_t pos) const {
+	const EspEventRecord record = getRecord(pos);
+	if (record.callback == NO_CALLBACK) {
+		return EspEvent(record.time_ms, EspEvent::callback_t(),
+						getHandle(pos));
+	}
+	return EspEvent(record.time_ms, _ids[record.callback], record.arg,
+					getHandle(pos));
+}
+
+void EspEventTable::runEvent(size_t pos) const {
+	const EspEventRecord record = getRecord(pos);
+	if (record.callback != NO_CALLBACK) {
+		EspEventRegistry::call(_ids[record.callback], record.arg);
+	}
+}
+
+void EspEventTable::read(void *dest, const void *src, size_t len) {
+#ifdef ESP8266
+	memcpy_P(dest, src, len);
+#else
+	memcpy(dest, src, len);
+#endif
+}
+
+bool EspEventTable::terminated(uint32_t offset) const {
+	char chunk[16];
+	while (offset < _stringsSize) {
+		const size_t len =
+			std::min((size_t)(_stringsSize - offset), sizeof(chunk));
+		read(chunk, _strings + offset, len);
+		if (memchr(chunk, '\0', len)) return true;
+		offset += len;
+	}
+	return false;
+}
+
+bool EspEventTable::handleEquals(uint16_t offset, const char *handle) const {
+#ifdef ESP8266
+	return !strcmp_P(handle, _strings + offset);
+#else
+	return !strcmp(handle, _strings + offset);
+#endif
+}
+
+/**
+ *
+ *
+ * 	Writing
+ *
+ */
+
+/**
+ * Collects the distinct registered callbacks used by a chain, in order of
+ * first use
+ *
+ * @return false if an event holds a callback that is not registered, or
+ * whose name is too long for load() to resolve
+ */
+static bool collectCallbacks(const EspEventChain &chain,
+							 std::vector<EspEventRegistry::id_t> &ids) {
+	for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+		const EspEvent event = chain.getEvent(pos);
+		const EspEventRegistry::id_t id = event.getCallbackId();
+		if (id == EspEventRegistry::INVALID_ID) {
+			if (event) return false;
+			continue;
+		}
+		if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+			if (strlen(EspEventRegistry::getName(id)) >=
+				__ESP_EVENT_TABLE_MAX_NAME__)
+				return false;
+			ids.push_back(id);
+		}
+	}
+	return true;
+}
+
+static size_t stringsSize(const EspEventChain &chain,
+						  const std::vector<EspEventRegistry::id_t> &ids) {
+	size_t size = 0;
+	for (EspEventRegistry::id_t id : ids) {
+		size += strlen(EspEventRegistry::getName(id)) + 1;
+	}
+	for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+		const char *handle = chain.getEvent(pos).getHandle();
+		if (strcmp(handle, "null")) size += strlen(handle) + 1;
+	}
+	return size;
+}
+
+size_t EspEventTable::serializedSize(const EspEventChain &chain) {
+	std::vector<EspEventRegistry::id_t> ids;
+	if (!collectCallbacks(chain, ids)) return 0;
+	if (chain.numEvents() >= NO_CALLBACK) return 0;
+
+	const size_t strings_size = stringsSize(chain, ids);
+	if (strings_size >= NO_HANDLE) return 0;
+
+	return alignedTo4(sizeof(EspEventTableHeader) +
+					  chain.numEvents() * sizeof(EspEventRecord) +
+					  ids.size() * sizeof(uint16_t)) +
+		   strings_size;
+}
+
+size_t EspEventTable::write(const EspEventChain &chain, uint8_t *out,
+							size_t capacity) {
+	const size_t size = serializedSize(chain);
+	if (size == 0 || out == nullptr || capacity < size) return 0;
+
+	std::vector<EspEventRegistry::id_t> ids;
+	collectCallbacks(chain, ids);
+
+	EspEventTableHeader header;
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.num_events = chain.numEvents();
+	header.num_callbacks = ids.size();
+	header.reserved = 0;
+	header.strings_size = stringsSize(chain, ids);
+
+	memset(out, 0, size);
+	memcpy(out, &header, sizeof(header));
+
+	uint8_t *records = out + sizeof(header);
+	uint8_t *names = records + header.num_events * sizeof(EspEventRecord);
+	char *strings = (char *)out + size - header.strings_size;
+	uint16_t string_pos = 0;
+
+	for (size_t i = 0; i < ids.size(); i++) {
+		const char *name = EspEventRegistry::getName(ids[i]);
+		memcpy(names + i * sizeof(uint16_t), &string_pos, sizeof(uint16_t));
+		strcpy(strings + string_pos, name);
+		string_pos += strlen(name) + 1;
+	}
+
+	for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+		const EspEvent event = chain.getEvent(pos);
+
+		EspEventRecord record;
+		record.time_ms = event.getTime();
+		record.arg = event.getArg();
+		record.callback = NO_CALLBACK;
+		record.handle = NO_HANDLE;
+
+		if (event.getCallbackId() != EspEventRegistry::INVALID_ID) {
+			record.callback =
+				std::distance(ids.begin(), std::find(ids.begin(), ids.end(),
+													 event.getCallbackId()));
+		}
+		if (strcmp(event.getHandle(), "null")) {
+			record.handle = string_pos;
+			strcpy(strings + string_pos, event.getHandle());
+			string_pos += strlen(event.getHandle()) + 1;
+		}
+		memcpy(records + pos * sizeof(record), &record, sizeof(record));
+	}
+	return size;
+}
+
+/**
+ *
+ *
+ * 	Host file mapping
+ *
+ */
+
+#if !defined(ARDUINO) && defined(__unix__)
+
+EspEventTableFile::EspEventTableFile() : _map(nullptr), _size(0) {}
+
+EspEventTableFile::~EspEventTableFile() { close(); }
+
+bool EspEventTableFile::open(const char *path) {
+	close();
+	if (path == nullptr) return false;
+
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) return false;
+
+	_map = map;
+	_size = st.st_size;
+	return true;
+}
+
+void EspEventTableFile::close() {
+	if (_map) munmap(_map, _size);
+	_map = nullptr;
+	_size = 0;
+}
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ * @file EspEventTable.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Compact binary format for the timings, handles and callback ids of an
+ * EspEventChain. Tables are read in place so they can live in flash / PROGMEM
+ * on device or in an mmap'd file on host
+ *
+ * Layout (little endian, offsets relative to the start of the table):
+ *
+ *   EspEventTableHeader                        16 bytes
+ *   EspEventRecord[num_events]                 12 bytes each
+ *   uint16_t callback_names[num_callbacks]     offsets into the string pool
+ *   padding to a multiple of 4
+ *   char strings[strings_size]                 NUL terminated strings
+ *
+ * Callbacks are stored by name and resolved against EspEventRegistry when the
+ * table is loaded, so the registration order may differ between the tool
+ * that wrote the table and the device that runs it
+ *
+ */
+
+#ifndef __ESP_EVENT_TABLE_H__
+#define __ESP_EVENT_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "EspEvent.h"
+#include "EspEventRegistry.h"
+
+class EspEventChain;
+
+/**
+ * Table header, stored once at the start of the table
+ */
+struct EspEventTableHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t num_events;
+	uint16_t num_callbacks;
+	uint16_t reserved;
+	uint32_t strings_size;
+};
+
+/**
+ * One event in the table
+ */
+struct EspEventRecord {
+	uint32_t time_ms;
+	uint32_t arg;
+	uint16_t callback; // Index into the callback names, NO_CALLBACK if none
+	uint16_t handle;   // Offset into the string pool, NO_HANDLE for "null"
+};
+
+/**
+ *
+ * Read-only view of a serialized event table. Nothing is copied out of the
+ * table except the resolved callback ids, one per distinct callback
+ *
+ */
+class EspEventTable {
+
+  public:
+	static const uint32_t MAGIC = 0x31434545; // "EEC1"
+	static const uint16_t VERSION = 1;
+	static const uint16_t NO_CALLBACK = 0xFFFF;
+	static const uint16_t NO_HANDLE = 0xFFFF;
+
+  private:
+	const uint8_t *_data;
+	const char *_strings;
+	const uint16_t *_names;
+	uint16_t _numEvents;
+	uint16_t _numCallbacks;
+	uint32_t _stringsSize;
+	std::vector<EspEventRegistry::id_t> _ids;
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: numEvents() == 0
+	 */
+	EspEventTable();
+
+	/**
+	 * @brief Points this view at a serialized table and resolves its
+	 * callbacks against EspEventRegistry
+	 *
+	 * pre: data stays valid and unmodified for the lifetime of this view and
+	 * of any chain constructed from it
+	 *
+	 * @param data	The serialized table, may reside in PROGMEM on ESP8266
+	 * @param size	The number of bytes available at data
+	 *
+	 * post: numEvents() == 0 on failure
+	 *
+	 * @return true if the table is valid and every callback is registered,
+	 * false otherwise. Strings must end within the pool, and callback names
+	 * must be shorter than 32 characters
+	 */
+	bool load(const uint8_t *data, size_t size);
+
+	/**
+	 * @brief Detaches this view from its table
+	 *
+	 * post: numEvents() == 0
+	 */
+	void clear();
+
+	/**
+	 * @brief Gets the number of events in the table
+	 *
+	 * @return 0 <= numEvents()
+	 */
+	size_t numEvents() const { return _numEvents; }
+
+	/**
+	 * @brief Reads the record for the event at a given position
+	 *
+	 * @param pos	The index, 0 <= pos < numEvents()
+	 *
+	 * @return A copy of the record
+	 */
+	EspEventRecord getRecord(size_t pos) const;
+
+	/**
+	 * @brief Gets the time for the event at a given position
+	 *
+	 * @param pos	The index, 0 <= pos < numEvents()
+	 *
+	 * @return Time in milliseconds
+	 */
+	unsigned long getTimeOf(size_t pos) const;
+
+	/**
+	 * @brief Gets the registry id of the callback for the event at a given
+	 * position
+	 *
+	 * @param pos	The index, 0 <= pos < numEvents()
+	 *
+	 * @return EspEventRegistry::INVALID_ID if the event has no callback
+	 */
+	EspEventRegistry::id_t getCallbackId(size_t pos) const;
+
+	/**
+	 * @brief Gets the handle for the event at a given position. On ESP8266
+	 * the returned pointer refers to PROGMEM if the table does
+	 *
+	 * @param pos	The index, 0 <= pos < numEvents()
+	 *
+	 * @return "null" if the event has no handle
+	 */
+	const char *getHandle(size_t pos) const;
+
+	/**
+	 * @brief Looks up an event using its identifying handle
+	 *
+	 * @param handle	The handle to look up, handle != null
+	 *
+	 * @return The position of the first event with a matching handle, -1 if
+	 * no match was found
+	 */
+	int getPositionFromHandle(const char *handle) const;
+
+	/**
+	 * @brief Builds a standalone EspEvent from the event at a given position
+	 *
+	 * @param pos	The index, 0 <= pos < numEvents()
+	 *
+	 * @return An event referencing the same registered callback
+	 */
+	EspEvent getEvent(size_t pos) const;
+
+	/**
+	 * @brief Runs the callback for the event at a given position
+	 *
+	 * @param pos	The index, 0 <= pos < numEvents()
+	 */
+	void runEvent(size_t pos) const;
+
+	/**
+	 * @brief Gets the number of bytes needed to serialize a chain
+	 *
+	 * @param chain	The chain to serialize
+	 *
+	 * @return The size in bytes, 0 if the chain cannot be serialized
+	 */
+	static size_t serializedSize(const EspEventChain &chain);
+
+	/**
+	 * @brief Serializes a chain. Every event must either have no callback or
+	 * reference a registered callback
+	 *
+	 * @param chain		The chain to serialize
+	 * @param out		The destination buffer
+	 * @param capacity	The number of bytes available at out
+	 *
+	 * @return The number of bytes written, 0 if the chain cannot be serialized
+	 * or capacity < serializedSize(chain)
+	 */
+	static size_t write(const EspEventChain &chain, uint8_t *out,
+						size_t capacity);
+
+  private:
+	static void read(void *dest, const void *src, size_t len);
+
+	/**
+	 * @brief Gets whether a string of the pool ends before the pool does
+	 *
+	 * @param offset	Offset of the string, offset < _stringsSize
+	 */
+	bool terminated(uint32_t offset) const;
+
+	bool handleEquals(uint16_t offset, const char *handle) const;
+};
+
+#if !defined(ARDUINO) && defined(__unix__)
+
+/**
+ *
+ * Host helper that maps a serialized table file into memory read-only
+ *
+ */
+class EspEventTableFile {
+
+  private:
+	void *_map;
+	size_t _size;
+
+  public:
+	EspEventTableFile();
+	~EspEventTableFile();
+
+	EspEventTableFile(const EspEventTableFile &) = delete;
+	EspEventTableFile &operator=(const EspEventTableFile &) = delete;
+
+	/**
+	 * @brief Maps a table file
+	 *
+	 * @param path	The file to map, path != null
+	 *
+	 * @return true if the file was mapped, false otherwise
+	 */
+	bool open(const char *path);
+
+	/**
+	 * @brief Unmaps the file
+	 *
+	 * post: data() == nullptr, size() == 0
+	 */
+	void close();
+
+	const uint8_t *data() const { return (const uint8_t *)_map; }
+	size_t size() const { return _size; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#include "EspEventTimeline.h"
+
+static unsigned long gcd(unsigned long a, unsigned long b) {
+	while (b) {
+		const unsigned long r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+EspEventTimeline::EspEventTimeline() : _hyperperiod(0) {}
+
+bool EspEventTimeline::compile(const std::vector<EspEventChain *> &chains,
+							   unsigned long max_period_ms) {
+	clear();
+
+	// The hyperperiod is the least common multiple of every chain's cycle
+	unsigned long period = 1;
+	size_t num_steps = 0;
+	for (const EspEventChain *chain : chains) {
+		__ESP_EVENT_CHECK__(chain, return false, "Null pointer exception!");
+		const unsigned long cycle = chain->getCycleTime();
+		if (cycle == 0) {
+			__ESP_EVENT_LOGE__("Cannot merge a chain with no total time");
+			return false;
+		}
+		const unsigned long factor = cycle / gcd(period, cycle);
+		if (period > max_period_ms / factor) {
+			__ESP_EVENT_LOGE__("Hyperperiod exceeds %lu ms", max_period_ms);
+			return false;
+		}
+		period *= factor;
+	}
+	for (const EspEventChain *chain : chains) {
+		size_t per_cycle = 0;
+		for (size_t pos = 0; pos < chain->numEvents(); pos++) {
+			if (pos == 0 || chain->callableAt(pos)) per_cycle++;
+		}
+		num_steps += per_cycle * (period / chain->getCycleTime());
+	}
+	if (num_steps > __ESP_EVENT_TIMELINE_MAX_STEPS__) {
+		__ESP_EVENT_LOGE__("Timeline of %i events exceeds the limit",
+						   num_steps);
+		return false;
+	}
+
+	// Chains are unrolled in order, so a stable sort keeps ties in that order
+	_steps.reserve(num_steps);
+	for (const EspEventChain *chain : chains) unroll(*chain, period);
+	std::stable_sort(
+		_steps.begin(), _steps.end(),
+		[](const step_t &a, const step_t &b) { return a.offset < b.offset; });
+
+	// Each merged event waits for the gap since the previous one, and the
+	// first waits for the gap left at the end of the hyperperiod
+	for (size_t pos = 0; pos < _steps.size(); pos++) {
+		const unsigned long time =
+			pos ? _steps[pos].offset - _steps[pos - 1].offset
+				: period - _steps.back().offset;
+		_chain.emplace_back(time, runStep, &_steps[pos]);
+	}
+	for (size_t pos = 0; pos < _steps.size(); pos++) {
+		const unsigned long cost =
+			_steps[pos].chain->getCostOf(_steps[pos].index);
+		if (cost) _chain.setCostOf(pos, cost);
+	}
+
+	_hyperperiod = period;
+	return true;
+}
+
+void EspEventTimeline::clear() {
+	_chain = EspEventChain();
+	_steps.clear();
+	_hyperperiod = 0;
+}
+
+void EspEventTimeline::runStep(EspEventContext &context) {
+	const step_t *step = context.getPayload<const step_t>();
+	EspEventContext source(const_cast<EspEventChain *>(step->chain),
+						   step->index, context.getScheduledTime(),
+						   context.getStartTime());
+	step->chain->runEventAt(step->index, source);
+}
+
+void EspEventTimeline::unroll(const EspEventChain &chain,
+							  unsigned long period_ms) {
+	// The offsets already skip events without a callback as the chain does
+	const std::vector<unsigned long> &offsets = chain.getOffsets();
+	for (unsigned long cycle = 0; cycle < period_ms; cycle += offsets.back()) {
+		for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+			if (pos && !chain.callableAt(pos)) continue;
+			if (cycle + offsets[pos] >= period_ms) break;
+			_steps.push_back({cycle + offsets[pos], &chain, pos});
+		}
+	}
+}
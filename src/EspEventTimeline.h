@@ -0,0 +1,133 @@
+/**
+ * @file EspEventTimeline.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Compiles several EspEventChains into a single chain that runs their events
+ * in order over the shared hyperperiod
+ *
+ *
+ *
+ */
+
+#ifndef __ESP_EVENT_TIMELINE_H__
+#define __ESP_EVENT_TIMELINE_H__
+
+// Longest hyperperiod compile() accepts by default, in milliseconds
+#ifndef __ESP_EVENT_TIMELINE_MAX_PERIOD__
+#define __ESP_EVENT_TIMELINE_MAX_PERIOD__ 3600000UL
+#endif
+
+// Most events a compiled timeline may hold
+#ifndef __ESP_EVENT_TIMELINE_MAX_STEPS__
+#define __ESP_EVENT_TIMELINE_MAX_STEPS__ 4096
+#endif
+
+#include <stddef.h>
+#include <vector>
+#include "EspEventChain.h"
+
+/**
+ *
+ * Merged schedule of several chains. Each chain is unrolled over the least
+ * common multiple of the chains' total times, and the events are sorted by
+ * their offset from the start. The result is a single chain, so one timer
+ * runs every event and the chains keep exact relative phase
+ *
+ * Events that fall on the same offset run in the order the chains were
+ * given. Source events are run in place and must outlive the timeline.
+ * Delays or jumps set by context callbacks are ignored, since the schedule
+ * is fixed when compiled
+ *
+ */
+class EspEventTimeline {
+
+  public:
+	struct step_t {
+		unsigned long offset;		// Time from the start of the hyperperiod
+		const EspEventChain *chain; // Chain the event belongs to
+		size_t index;				// Position of the event in chain
+	};
+
+  private:
+	std::vector<step_t> _steps;
+	EspEventChain _chain;
+	unsigned long _hyperperiod;
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: numSteps() == 0
+	 */
+	EspEventTimeline();
+
+	EspEventTimeline(const EspEventTimeline &) = delete;
+	EspEventTimeline &operator=(const EspEventTimeline &) = delete;
+
+	/**
+	 * @brief Builds the merged schedule, replacing any previous one
+	 *
+	 * @param chains		The chains to merge, each with a nonzero total time.
+	 * They should not be running while the timeline is
+	 * @param max_period_ms	The longest hyperperiod to accept
+	 *
+	 * post: getChain() runs every event of every chain at its offset,
+	 * getChain().isRunning() == false
+	 *
+	 * @return false if a chain has no time or the hyperperiod or number of
+	 * events is too large, leaving the timeline empty
+	 */
+	bool
+	compile(const std::vector<EspEventChain *> &chains,
+			unsigned long max_period_ms = __ESP_EVENT_TIMELINE_MAX_PERIOD__);
+
+	/**
+	 * @brief Gets the merged chain. Start, stop or add it to a dispatcher as
+	 * with any other chain
+	 */
+	EspEventChain &getChain() { return _chain; }
+
+	/**
+	 * @brief Gets the length of the merged schedule
+	 *
+	 * @return Least common multiple of the total time of every chain
+	 */
+	unsigned long getHyperperiod() const { return _hyperperiod; }
+
+	/**
+	 * @brief Gets the number of events in the merged schedule
+	 *
+	 * @return getChain().numEvents()
+	 */
+	size_t numSteps() const { return _steps.size(); }
+
+	/**
+	 * @brief Gets the source of a merged event
+	 *
+	 * @param pos	Position in the merged schedule, 0 <= pos < numSteps()
+	 */
+	const step_t &getStep(size_t pos) const { return _steps[pos]; }
+
+	/**
+	 * @brief Clears the merged schedule
+	 *
+	 * post: numSteps() == 0, getChain().isRunning() == false
+	 */
+	void clear();
+
+  private:
+	/**
+	 * @brief Context callback of every merged event, runs the source event
+	 * described by the step_t payload
+	 */
+	static void runStep(EspEventContext &context);
+
+	/**
+	 * @brief Appends the events of one chain visited over period_ms
+	 */
+	void unroll(const EspEventChain &chain, unsigned long period_ms);
+};
+
+#endif
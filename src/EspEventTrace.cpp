@@ -0,0 +1,80 @@
+#include "EspEventTrace.h"
+#include <string.h>
+
+#ifndef ARDUINO
+#include <stdio.h>
+#endif
+
+const EspEventTraceRecord &EspEventTrace::get(size_t pos) const {
+	const uint32_t head = _head.load(std::memory_order_acquire);
+	const uint32_t first = head < SIZE ? 0 : head - SIZE;
+	return _records[(first + pos) & (SIZE - 1)];
+}
+
+size_t EspEventTrace::dump(uint8_t *buffer, size_t max_len) const {
+	EspEventTraceHeader header;
+	header.magic = MAGIC;
+	header.num_records = size();
+	header.dropped = getDropped();
+
+	const size_t len =
+		sizeof(header) + sizeof(EspEventTraceRecord) * header.num_records;
+	if (!buffer || len > max_len) return len;
+
+	memcpy(buffer, &header, sizeof(header));
+	EspEventTraceRecord *records =
+		reinterpret_cast<EspEventTraceRecord *>(buffer + sizeof(header));
+	for (size_t i = 0; i < header.num_records; i++) {
+		memcpy(&records[i], &get(i), sizeof(EspEventTraceRecord));
+	}
+	return len;
+}
+
+bool EspEventTrace::load(const uint8_t *data, size_t len) {
+	clear();
+	EspEventTraceHeader header;
+	if (!data || len < sizeof(header)) return false;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != MAGIC || header.num_records > SIZE ||
+		len < sizeof(header) + sizeof(EspEventTraceRecord) * header.num_records)
+		return false;
+
+	// Dropped records are counted by starting the head past them
+	const uint32_t first = header.num_records < SIZE ? 0 : header.dropped;
+	const EspEventTraceRecord *records =
+		reinterpret_cast<const EspEventTraceRecord *>(data + sizeof(header));
+	for (size_t i = 0; i < header.num_records; i++) {
+		memcpy(&_records[(first + i) & (SIZE - 1)], &records[i],
+			   sizeof(EspEventTraceRecord));
+	}
+	_head.store(first + header.num_records, std::memory_order_release);
+	return true;
+}
+
+#ifndef ARDUINO
+std::string EspEventTrace::toChromeJson() const {
+	std::string json = "{\"traceEvents\":[";
+	char line[192];
+
+	// Timestamps are unwrapped from 32 bits by assuming records are in order
+	uint64_t ts = 0;
+	uint32_t last_us = 0;
+	for (size_t i = 0; i < size(); i++) {
+		const EspEventTraceRecord &record = get(i);
+		ts = i ? ts + (uint32_t)(record.start_us - last_us) : record.start_us;
+		last_us = record.start_us;
+
+		snprintf(line, sizeof(line),
+				 "%s{\"name\":\"event %u\",\"cat\":\"chain\",\"ph\":\"X\","
+				 "\"ts\":%llu,\"dur\":%lu,\"pid\":0,\"tid\":%u,"
+				 "\"args\":{\"scheduled_ms\":%lu}}",
+				 i ? "," : "", (unsigned)record.index, (unsigned long long)ts,
+				 (unsigned long)(uint32_t)(record.end_us - record.start_us),
+				 (unsigned)record.chain_id,
+				 (unsigned long)record.scheduled_ms);
+		json += line;
+	}
+	json += "],\"displayTimeUnit\":\"ms\"}";
+	return json;
+}
+#endif
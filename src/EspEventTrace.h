@@ -0,0 +1,177 @@
+/**
+ * @file EspEventTrace.h
+ * @author Scott Chase Waggener tidal@utexas.edu
+ * @date 2/2/18
+ *
+ * @description
+ * Fixed size ring buffer of the events run by an EspEventDispatcher, for
+ * viewing chain timing as a timeline
+ *
+ * Build flags:
+ *
+ *   -D__ESP_EVENT_TRACE__=1            Record events, off by default
+ *   -D__ESP_EVENT_TRACE_SIZE__=256     Records kept, a power of two
+ *
+ * Dump layout (little endian):
+ *
+ *   EspEventTraceHeader                        8 bytes
+ *   EspEventTraceRecord[num_records]           16 bytes each, oldest first
+ *
+ */
+
+#ifndef __ESP_EVENT_TRACE_H__
+#define __ESP_EVENT_TRACE_H__
+
+#ifndef __ESP_EVENT_TRACE__
+#define __ESP_EVENT_TRACE__ 0
+#endif
+
+#ifndef __ESP_EVENT_TRACE_SIZE__
+#define __ESP_EVENT_TRACE_SIZE__ 256
+#endif
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef ARDUINO
+#include <string>
+#endif
+
+/**
+ * Dump header, dropped counts the records overwritten before the dump
+ */
+struct EspEventTraceHeader {
+	uint16_t magic;
+	uint16_t num_records;
+	uint32_t dropped;
+};
+
+/**
+ * One event run by the dispatcher
+ */
+struct EspEventTraceRecord {
+	uint32_t scheduled_ms; // Deadline of the event on EspEventClock
+	uint32_t start_us;	 // EspEventClock::nowMicros() before the callback
+	uint32_t end_us;	   // EspEventClock::nowMicros() after the callback
+	uint16_t chain_id;	 // EspEventChain::getId()
+	uint16_t index;		   // Position of the event in the chain
+};
+
+/**
+ *
+ * Records are written by a single dispatcher without locks. Each record is
+ * stored before the count is published, so a reader on another core sees
+ * only complete records, apart from the oldest ones being overwritten while
+ * it reads
+ *
+ * 		EspEventTrace trace;
+ * 		dispatcher.setTrace(&trace);
+ *
+ * 		// Later, send the dump to a host
+ * 		size_t len = trace.dump(buffer, sizeof(buffer));
+ *
+ * 		// On the host
+ * 		trace.load(buffer, len);
+ * 		std::string json = trace.toChromeJson();
+ *
+ */
+class EspEventTrace {
+
+  public:
+	static const uint16_t MAGIC = 0x5445; // "ET"
+	static const size_t SIZE = __ESP_EVENT_TRACE_SIZE__;
+
+  private:
+	static_assert((SIZE & (SIZE - 1)) == 0 && SIZE <= 0xFFFF,
+				  "__ESP_EVENT_TRACE_SIZE__ must be a power of two");
+
+	EspEventTraceRecord _records[SIZE];
+
+	// Number of records ever written, the next slot is _head % SIZE
+	std::atomic<uint32_t> _head;
+
+  public:
+	/**
+	 * @brief Default constructor
+	 *
+	 * post: size() == 0
+	 */
+	EspEventTrace() : _head(0) {}
+
+	EspEventTrace(const EspEventTrace &) = delete;
+	EspEventTrace &operator=(const EspEventTrace &) = delete;
+
+	/**
+	 * @brief Appends a record, overwriting the oldest once full. Only one
+	 * thread may record into a trace
+	 */
+	void record(const EspEventTraceRecord &record) {
+		const uint32_t head = _head.load(std::memory_order_relaxed);
+		_records[head & (SIZE - 1)] = record;
+		_head.store(head + 1, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Gets the number of records held
+	 *
+	 * @return 0 <= size() <= SIZE
+	 */
+	size_t size() const {
+		const uint32_t head = _head.load(std::memory_order_acquire);
+		return head < SIZE ? head : SIZE;
+	}
+
+	/**
+	 * @brief Gets the number of records that were overwritten
+	 */
+	uint32_t getDropped() const {
+		const uint32_t head = _head.load(std::memory_order_acquire);
+		return head < SIZE ? 0 : head - SIZE;
+	}
+
+	/**
+	 * @brief Gets a record
+	 *
+	 * @param pos	Position from the oldest record, 0 <= pos < size()
+	 */
+	const EspEventTraceRecord &get(size_t pos) const;
+
+	/**
+	 * @brief Removes every record
+	 *
+	 * post: size() == 0, getDropped() == 0
+	 */
+	void clear() { _head.store(0, std::memory_order_release); }
+
+	/**
+	 * @brief Writes the records, oldest first, in the compact dump layout
+	 *
+	 * @param buffer	Destination, may be nullptr to get the size needed
+	 * @param max_len	Size of buffer in bytes
+	 *
+	 * @return Bytes needed for the dump, nothing is written if larger than
+	 * max_len
+	 */
+	size_t dump(uint8_t *buffer, size_t max_len) const;
+
+	/**
+	 * @brief Replaces the records with those of a dump
+	 *
+	 * @return false if data is not a valid dump, leaving the trace empty
+	 */
+	bool load(const uint8_t *data, size_t len);
+
+#ifndef ARDUINO
+	/**
+	 * @brief Converts the records to the Chrome trace event format, which
+	 * chrome://tracing and Perfetto open. Each chain is shown as a thread
+	 * and each event as a slice lasting as long as its callback
+	 *
+	 * @return JSON object with a traceEvents array
+	 */
+	std::string toChromeJson() const;
+#endif
+};
+
+#endif
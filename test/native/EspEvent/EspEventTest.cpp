@@ -1,8 +1,26 @@
 #ifdef UNIT_TEST
 
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
 #include "EspEvent.h"
+#include "EspEventTable.h"
 #include "unity.h"
 
+// Counts heap allocations made by the code under test
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+	allocations++;
+	void *ptr = malloc(size ? size : 1);
+	if (ptr == nullptr) throw std::bad_alloc();
+	return ptr;
+}
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t size) noexcept { free(ptr); }
+
 EspEvent e1;
 EspEvent e2(10, []() {});
 const char *HANDLE = "handle";
@@ -78,6 +96,255 @@ void setCallback() {
 	TEST_ASSERT_TRUE_MESSAGE(e3_callback_ran, msg);
 }
 
+volatile uint32_t registry_total = 0;
+void addToTotal(uint32_t arg) { registry_total = registry_total + arg; }
+EspEventRegistry::id_t ADD = EspEventRegistry::add("add", addToTotal);
+
+void registryEvent() {
+	EspEvent e(10, ADD, 5, HANDLE);
+
+	TEST_ASSERT_TRUE_MESSAGE(e, "Registry event callable");
+	TEST_ASSERT_EQUAL_MESSAGE(ADD, e.getCallbackId(), "getCallbackId()");
+	TEST_ASSERT_EQUAL_MESSAGE(5, e.getArg(), "getArg()");
+
+	registry_total = 0;
+	e.runEvent();
+	TEST_ASSERT_EQUAL_MESSAGE(5, registry_total, "runEvent() calls registry");
+
+	EspEvent bad(10, (EspEventRegistry::id_t)1000);
+	TEST_ASSERT_FALSE_MESSAGE(bad, "Unregistered id not callable");
+}
+
+void copyEvent() {
+	int count = 0;
+	EspEvent original(10, [&]() { count++; });
+	EspEvent copy(original);
+	EspEvent assigned;
+	assigned = copy;
+	original.setCallback(EspEvent::callback_t());
+
+	copy.runEvent();
+	assigned.runEvent();
+	TEST_ASSERT_FALSE_MESSAGE(original, "Cleared callback");
+	TEST_ASSERT_EQUAL_MESSAGE(2, count, "Copies keep their own callback");
+
+	EspEvent moved(std::move(copy));
+	moved.runEvent();
+	TEST_ASSERT_FALSE_MESSAGE(copy, "Moved-from event is empty");
+	TEST_ASSERT_EQUAL_MESSAGE(3, count, "Moved event keeps callback");
+}
+
+struct Counter {
+	int count;
+	unsigned long lateness;
+	size_t index;
+};
+
+void countLateness(EspEventContext &context) {
+	Counter *counter = context.getPayload<Counter>();
+	counter->count++;
+	counter->lateness = context.getLateness();
+	counter->index = context.getIndex();
+}
+
+void contextEvent() {
+	Counter counter = {0, 0, 0};
+	EspEvent e(10, countLateness, &counter, HANDLE);
+
+	TEST_ASSERT_TRUE_MESSAGE(e, "Context event callable");
+	TEST_ASSERT_EQUAL_MESSAGE(&counter, e.getPayload(), "getPayload()");
+
+	EspEventContext context(nullptr, 3, 100, 107);
+	e.runEvent(context);
+	TEST_ASSERT_EQUAL_MESSAGE(1, counter.count, "Callback ran");
+	TEST_ASSERT_EQUAL_MESSAGE(7, counter.lateness, "getLateness()");
+	TEST_ASSERT_EQUAL_MESSAGE(3, counter.index, "getIndex()");
+
+	EspEventContext early(nullptr, 0, 100, 90);
+	e.runEvent(early);
+	TEST_ASSERT_EQUAL_MESSAGE(0, counter.lateness, "No lateness when early");
+
+	EspEvent copy = e;
+	copy.runEvent();
+	TEST_ASSERT_EQUAL_MESSAGE(3, counter.count, "Copy keeps payload");
+}
+
+void backOff(EspEventContext &context) {
+	unsigned long *delay = context.getPayload<unsigned long>();
+	*delay *= 2;
+	context.setNextDelay(*delay);
+	if (*delay > 100) context.jumpTo(0);
+}
+
+void contextOverrides() {
+	unsigned long delay = 40;
+	EspEvent e(10, backOff, &delay);
+
+	EspEventContext first;
+	e.runEvent(first);
+	TEST_ASSERT_EQUAL_MESSAGE(80, first.getNextDelay(), "setNextDelay()");
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventContext::NO_JUMP, first.getJump(),
+							  "No jump by default");
+
+	EspEventContext second;
+	e.runEvent(second);
+	TEST_ASSERT_EQUAL_MESSAGE(160, second.getNextDelay(), "setNextDelay()");
+	TEST_ASSERT_EQUAL_MESSAGE(0, second.getJump(), "jumpTo()");
+	TEST_ASSERT_EQUAL_MESSAGE(10, e.getTime(), "Event time unchanged");
+}
+
+template <int N> void numbered(EspEventContext &context) {
+	*context.getPayload<int>() += N;
+}
+
+template <int... N> int runNumbered(std::integer_sequence<int, N...>) {
+	int total = 0;
+	const EspEvent events[] = {EspEvent(10, numbered<N>, &total)...};
+	for (const EspEvent &event : events) {
+		if (event) event.runEvent();
+	}
+	return total;
+}
+
+void manyContextCallbacks() {
+	// Each event holds its own function, so there is no limit on how many
+	// distinct functions a program uses
+	const int total = runNumbered(std::make_integer_sequence<int, 100>());
+	TEST_ASSERT_EQUAL_MESSAGE(99 * 100 / 2, total,
+							  "Every event runs its own function");
+}
+
+/**
+ * Members of EspEvent before events could reference the registry, with the
+ * std::function held inline
+ */
+struct BaselineEvent {
+	const char *handle;
+	unsigned long time_ms;
+	EspEvent::callback_t callback;
+	uint32_t arg;
+	EspEventRegistry::id_t callbackId;
+};
+
+/**
+ * Counts allocations and time to build then copy events
+ *
+ * @return Allocations per event, nanoseconds per copy in copy_ns
+ */
+template <typename T, typename F>
+double allocationsPerEvent(size_t count, F make, double &copy_ns) {
+	std::vector<T> events, copies;
+	events.reserve(count);
+	copies.reserve(count);
+
+	const size_t before = allocations;
+	for (size_t i = 0; i < count; i++) events.push_back(make(i));
+	auto start = std::chrono::steady_clock::now();
+	for (const T &event : events) copies.push_back(event);
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	copy_ns = std::chrono::duration<double, std::nano>(elapsed).count() /
+			  count;
+	return (double)(allocations - before) / count;
+}
+
+void copyBenchmark() {
+	const size_t NUM_EVENTS = 1000;
+	double function_ns, baseline_ns, registry_ns, context_ns;
+
+	// Small and trivially copyable, so the baseline stored it inline
+	const double function_allocs = allocationsPerEvent<EspEvent>(
+		NUM_EVENTS,
+		[](size_t i) {
+			return EspEvent(10, [i]() { registry_total = registry_total + i; });
+		},
+		function_ns);
+	const double baseline_allocs = allocationsPerEvent<BaselineEvent>(
+		NUM_EVENTS,
+		[](size_t i) {
+			auto add = [i]() { registry_total = registry_total + i; };
+			return BaselineEvent{"null", 10, add, 0,
+								 EspEventRegistry::INVALID_ID};
+		},
+		baseline_ns);
+	const double registry_allocs = allocationsPerEvent<EspEvent>(
+		NUM_EVENTS, [](size_t i) { return EspEvent(10, ADD, i); },
+		registry_ns);
+	const double context_allocs = allocationsPerEvent<EspEvent>(
+		NUM_EVENTS, [](size_t i) { return EspEvent(10, backOff); },
+		context_ns);
+
+	char msg[160];
+	snprintf(msg, sizeof(msg),
+			 "std::function event: %u bytes, %.1f allocations, "
+			 "%.2f ns/copy",
+			 (unsigned)sizeof(EspEvent), function_allocs, function_ns);
+	TEST_MESSAGE(msg);
+	snprintf(msg, sizeof(msg),
+			 "baseline event: %u bytes, %.1f allocations, %.2f ns/copy",
+			 (unsigned)sizeof(BaselineEvent), baseline_allocs, baseline_ns);
+	TEST_MESSAGE(msg);
+	snprintf(msg, sizeof(msg),
+			 "registry event: %.1f allocations, %.2f ns/copy, "
+			 "context event: %.1f allocations, %.2f ns/copy",
+			 registry_allocs, registry_ns, context_allocs, context_ns);
+	TEST_MESSAGE(msg);
+
+	// Small lambdas stay inside the event, as they did in the baseline
+	TEST_ASSERT_TRUE_MESSAGE(function_allocs == 0, "Stored inline");
+	TEST_ASSERT_TRUE_MESSAGE(baseline_allocs == 0, "Stored inline");
+	TEST_ASSERT_TRUE_MESSAGE(registry_allocs == 0, "No heap");
+	TEST_ASSERT_TRUE_MESSAGE(context_allocs == 0, "No heap");
+	TEST_ASSERT_TRUE(sizeof(EspEvent) < sizeof(BaselineEvent));
+}
+
+/**
+ * Compares the size and dispatch cost of events that reference the registry
+ * against events that hold a std::function
+ */
+template <typename F>
+double nsPerEvent(const std::vector<EspEvent> &events, F run) {
+	const int ROUNDS = 200;
+	auto start = std::chrono::steady_clock::now();
+	for (int round = 0; round < ROUNDS; round++) {
+		for (size_t pos = 0; pos < events.size(); pos++) run(pos);
+	}
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	return std::chrono::duration<double, std::nano>(elapsed).count() /
+		   (ROUNDS * events.size());
+}
+
+void dispatchBenchmark() {
+	const size_t NUM_EVENTS = 1000;
+	std::vector<EspEvent> function_events, registry_events;
+	for (size_t i = 0; i < NUM_EVENTS; i++) {
+		function_events.emplace_back(
+			10, [i]() { registry_total = registry_total + i; });
+		registry_events.emplace_back(10, ADD, i);
+	}
+
+	double function_ns = nsPerEvent(
+		function_events, [&](size_t pos) { function_events[pos].runEvent(); });
+	double registry_ns = nsPerEvent(
+		registry_events, [&](size_t pos) { registry_events[pos].runEvent(); });
+
+	char msg[160];
+	snprintf(msg, sizeof(msg),
+			 "std::function event: %u bytes, %.2f ns/dispatch",
+			 (unsigned)sizeof(EspEvent), function_ns);
+	TEST_MESSAGE(msg);
+	snprintf(msg, sizeof(msg),
+			 "registry event: %u bytes (%u in a table), %.2f ns/dispatch",
+			 (unsigned)sizeof(EspEvent), (unsigned)sizeof(EspEventRecord),
+			 registry_ns);
+	TEST_MESSAGE(msg);
+
+	TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(
+		8 + sizeof(void *) + sizeof(EspEvent::callback_t), sizeof(EspEvent),
+		"Kinds of callback share storage");
+	TEST_ASSERT_EQUAL_MESSAGE(12, sizeof(EspEventRecord), "Table record size");
+}
+
 int main(int argc, char **argv) {
 	UNITY_BEGIN();
 	RUN_TEST(empty_constructor);
@@ -87,6 +354,13 @@ int main(int argc, char **argv) {
 	RUN_TEST(getHandle);
 	RUN_TEST(setTime);
 	RUN_TEST(setCallback);
+	RUN_TEST(registryEvent);
+	RUN_TEST(copyEvent);
+	RUN_TEST(contextEvent);
+	RUN_TEST(contextOverrides);
+	RUN_TEST(manyContextCallbacks);
+	RUN_TEST(copyBenchmark);
+	RUN_TEST(dispatchBenchmark);
 	UNITY_END();
 	return 0;
 }
@@ -0,0 +1,179 @@
+#ifdef UNIT_TEST
+
+#include <stdio.h>
+#include "EspEventAnalysis.h"
+#include "EspEventChain.h"
+#include "EspEventSimulator.h"
+#include "EspEventTrace.h"
+#include "unity.h"
+
+void nothing(EspEventContext &context) {}
+
+/* a every 10 ms, b at 0 and 5 ms of 20, c every 50 ms */
+struct Set {
+	EspEventChain a, b, c;
+	Set()
+		: a(EspEvent(10, nothing)),
+		  b(EspEvent(15, nothing), EspEvent(5, nothing)),
+		  c(EspEvent(50, nothing)) {
+		a.setCostOf(0, 1000);
+		b.setCostOf(0, 500);
+		b.setCostOf(1, 1500);
+		c.setCostOf(0, 3000);
+	}
+};
+
+void bound_holds_in_simulation() {
+	Set set;
+	EspEventAnalysis analysis;
+	analysis.add(set.a);
+	analysis.add(set.b);
+	analysis.add(set.c);
+	TEST_ASSERT_EQUAL_MESSAGE(4, analysis.numSteps(), "b has two steps");
+	TEST_ASSERT_TRUE_MESSAGE(analysis.analyze(), "Feasible");
+	TEST_ASSERT_TRUE(analysis.getUtilization() > 0.259f);
+	TEST_ASSERT_TRUE(analysis.getUtilization() < 0.261f);
+
+	// a can come due behind the longest step of b and all of c
+	TEST_ASSERT_EQUAL(1000 + 1500 + 3000, analysis.getWorstResponse(set.a));
+	TEST_ASSERT_EQUAL_MESSAGE(5000, analysis.getStep(1).deadline_us,
+							  "b's first step before its second");
+	TEST_ASSERT_EQUAL(500 + 1000 + 3000, analysis.getStep(1).response_us);
+
+	// Started so that a is queued last
+	EspEventSimulator sim;
+	EspEventChain *chains[] = {&set.c, &set.b, &set.a};
+	for (EspEventChain *chain : chains) sim.add(*chain);
+	for (EspEventChain *chain : chains) chain->start();
+	sim.run(10000);
+
+	char msg[128];
+	for (EspEventChain *chain : chains) {
+		const uint64_t response = analysis.getWorstResponse(*chain);
+		const uint32_t late = sim.getReport(*chain).max_lateness_us;
+		snprintf(msg, sizeof(msg), "worst response %lu us, %lu us late",
+				 (unsigned long)response, (unsigned long)late);
+		TEST_MESSAGE(msg);
+		TEST_ASSERT_TRUE_MESSAGE(late + chain->getCostOf(0) <= response,
+								 "Bound holds");
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(3500, sim.getReport(set.a).max_lateness_us,
+							  "Behind c and b");
+
+	// Below full utilization, but a may wait too long behind d
+	EspEventChain d(EspEvent(10, nothing));
+	d.setCostOf(0, 6000);
+	analysis.add(d);
+	TEST_ASSERT_FALSE_MESSAGE(analysis.analyze(), "Infeasible");
+	TEST_ASSERT_TRUE(analysis.getUtilization() < 1.0f);
+	TEST_ASSERT_EQUAL(1000 + 6000 + 1500 + 3000,
+					  analysis.getWorstResponse(set.a));
+}
+
+void admission_control() {
+	Set set;
+	EspEventChain d(EspEvent(10, nothing));
+	d.setCostOf(0, 6000);
+
+	EspEventSimulator sim;
+	EspEventChain *chains[] = {&set.a, &set.b, &set.c, &d};
+	for (EspEventChain *chain : chains) sim.add(*chain);
+	EspEventDispatcher &dispatcher = sim.getDispatcher();
+	dispatcher.setAdmissionControl(true);
+
+	set.a.start();
+	set.b.start();
+	set.c.start();
+	TEST_ASSERT_TRUE(set.c.isRunning());
+	d.start();
+	TEST_ASSERT_FALSE_MESSAGE(d.isRunning(), "Refused");
+	TEST_ASSERT_EQUAL(1, dispatcher.getRejected());
+
+	// b's first step still cannot wait out d
+	set.c.stop();
+	d.start();
+	TEST_ASSERT_FALSE(d.isRunning());
+	TEST_ASSERT_EQUAL(2, dispatcher.getRejected());
+
+	set.b.stop();
+	d.start();
+	TEST_ASSERT_TRUE_MESSAGE(d.isRunning(), "Admitted");
+	set.a.start();
+	TEST_ASSERT_TRUE_MESSAGE(set.a.isRunning(), "Restart admitted");
+	sim.run(1000);
+	TEST_ASSERT_TRUE(sim.getReport(set.a).max_lateness_us <= 6000);
+	TEST_ASSERT_EQUAL(2, dispatcher.getRejected());
+}
+
+static void setCosts(EspEventChain &chain, uint32_t cost_us) {
+	for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+		chain.setCostOf(pos, cost_us);
+	}
+}
+
+void admission_step_limit() {
+	// One more step than admission control analyzes
+	EspEventChain many;
+	for (size_t pos = 0; pos <= __ESP_EVENT_ADMISSION_MAX_STEPS__; pos++) {
+		many.push_back(EspEvent(10, nothing));
+	}
+	EspEventSimulator sim;
+	sim.add(many);
+	EspEventDispatcher &dispatcher = sim.getDispatcher();
+	dispatcher.setAdmissionControl(true);
+
+	// Light enough for the linear bound, however many steps
+	setCosts(many, 1);
+	EspEventAnalysis analysis;
+	analysis.add(many);
+	TEST_ASSERT_TRUE_MESSAGE(analysis.checkBound(), "Within the bound");
+	many.start();
+	TEST_ASSERT_TRUE_MESSAGE(many.isRunning(), "Admitted by the bound");
+	TEST_ASSERT_EQUAL(0, dispatcher.getUnanalyzed());
+	many.stop();
+
+	// Only the exact analysis could tell, and there are too many steps
+	setCosts(many, 400);
+	analysis.clear();
+	analysis.add(many);
+	TEST_ASSERT_FALSE_MESSAGE(analysis.checkBound(), "Past the bound");
+	TEST_ASSERT_TRUE_MESSAGE(analysis.analyze(), "Feasible");
+	many.start();
+	TEST_ASSERT_TRUE_MESSAGE(many.isRunning(), "Admitted unanalyzed");
+	TEST_ASSERT_EQUAL(1, dispatcher.getUnanalyzed());
+	TEST_ASSERT_EQUAL_MESSAGE(0, dispatcher.getRejected(), "Not an overload");
+	many.stop();
+
+	// Over full utilization no analysis is needed to refuse
+	setCosts(many, 12000);
+	many.start();
+	TEST_ASSERT_FALSE_MESSAGE(many.isRunning(), "Refused");
+	TEST_ASSERT_EQUAL(1, dispatcher.getRejected());
+	TEST_ASSERT_EQUAL(1, dispatcher.getUnanalyzed());
+}
+
+void loads_measured_costs() {
+	EspEventTrace trace;
+	trace.record({0, 1000, 1200, 3, 0});
+	trace.record({10, 11000, 11350, 3, 0});
+	trace.record({10, 11350, 11400, 4, 1});
+
+	EspEventChain chain(EspEvent(10, nothing), EspEvent(10, nothing));
+	chain.setId(3);
+	chain.setCostOf(1, 75);
+	TEST_ASSERT_EQUAL(1, EspEventAnalysis::loadCosts(chain, trace));
+	TEST_ASSERT_EQUAL_MESSAGE(350, chain.getCostOf(0), "Longest run");
+	TEST_ASSERT_EQUAL_MESSAGE(75, chain.getCostOf(1), "Declared cost kept");
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(bound_holds_in_simulation);
+	RUN_TEST(admission_control);
+	RUN_TEST(admission_step_limit);
+	RUN_TEST(loads_measured_costs);
+	UNITY_END();
+	return 0;
+}
+
+#endif
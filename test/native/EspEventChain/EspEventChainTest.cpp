@@ -0,0 +1,424 @@
+#ifdef UNIT_TEST
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+#include "EspEventAnalysis.h"
+#include "EspEventChain.h"
+#include "EspEventSimulator.h"
+#include "EspEventTimeline.h"
+#include "unity.h"
+
+struct Fired {
+	unsigned long time;
+	size_t index;
+};
+
+void record(EspEventContext &context) {
+	context.getPayload<std::vector<Fired>>()->push_back(
+		{context.getStartTime(), context.getIndex()});
+}
+
+/* Events at offsets 0, 100, 100, 400 with a cycle of 1000 */
+#define CHAIN(log)                                                             \
+	EspEvent(600, record, &log), EspEvent(100, record, &log),                  \
+		EspEvent(0, record, &log), EspEvent(300, record, &log)
+
+void start_at_offset() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+	EspEventChain chain(CHAIN(log));
+	sim.add(chain);
+
+	chain.startAt(250);
+	TEST_ASSERT_EQUAL_MESSAGE(3, chain.getCurrentEvent(), "Pending event");
+	TEST_ASSERT_EQUAL_MESSAGE(150, chain.getTimeUntilNextEvent(),
+							  "Remainder of the delay");
+	TEST_ASSERT_EQUAL_MESSAGE(250, chain.getCurrentOffset(), "Offset");
+
+	sim.run(800);
+	TEST_ASSERT_EQUAL_MESSAGE(2, log.size(), "Events after the offset");
+	TEST_ASSERT_EQUAL_MESSAGE(150, log[0].time, "Partial delay");
+	TEST_ASSERT_EQUAL_MESSAGE(3, log[0].index, "Event after offset");
+	TEST_ASSERT_EQUAL_MESSAGE(750, log[1].time, "Wraps at the cycle");
+	TEST_ASSERT_EQUAL_MESSAGE(0, log[1].index, "First event");
+	TEST_ASSERT_EQUAL_MESSAGE(50, chain.getCurrentOffset(), "Offset");
+
+	// Starting on an event runs it and any sharing its offset immediately
+	chain.stop();
+	log.clear();
+	chain.startAt(2100);
+	sim.run(1);
+	TEST_ASSERT_EQUAL_MESSAGE(2, log.size(), "Events at the offset");
+	TEST_ASSERT_EQUAL_MESSAGE(1, log[0].index, "First event at offset");
+	TEST_ASSERT_EQUAL_MESSAGE(2, log[1].index, "Second event at offset");
+}
+
+void seek_running_chain() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+	EspEventChain chain(CHAIN(log));
+	sim.add(chain);
+
+	chain.runOnce();
+	sim.run(50);
+	chain.seek(250);
+	TEST_ASSERT_EQUAL_MESSAGE(250, chain.getCurrentOffset(), "Seeked");
+
+	sim.run(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(2, log.size(), "Run once ends at the wrap");
+	TEST_ASSERT_EQUAL_MESSAGE(3, log[1].index, "Last event");
+	TEST_ASSERT_FALSE_MESSAGE(chain.isRunning(), "Stopped");
+
+	chain.runOnce();
+	chain.seek(900);
+	TEST_ASSERT_FALSE_MESSAGE(chain.isRunning(), "Nothing left of the pass");
+
+	// Modifying the chain moves later offsets
+	chain.changeTimeOf(3, 100);
+	chain.startAt(250);
+	TEST_ASSERT_EQUAL_MESSAGE(0, chain.getCurrentEvent(), "Wrapped");
+	TEST_ASSERT_EQUAL_MESSAGE(550, chain.getTimeUntilNextEvent(),
+							  "New cycle of 800");
+}
+
+void skipped_events() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+	EspEventChain chain(EspEvent(600, record, &log), EspEvent(),
+						EspEvent(100, record, &log),
+						EspEvent(300, record, &log));
+	chain.changeTimeOf(1, 200);
+	sim.add(chain);
+	TEST_ASSERT_EQUAL_MESSAGE(1200, chain.getTotalTime(), "All times");
+	TEST_ASSERT_EQUAL_MESSAGE(1000, chain.getCycleTime(),
+							  "Without the event lacking a callback");
+
+	// The skipped event takes its time with it when the chain runs
+	chain.start();
+	sim.run(1500);
+	TEST_ASSERT_EQUAL_MESSAGE(6, log.size(), "Events run");
+	TEST_ASSERT_EQUAL_MESSAGE(100, log[1].time, "Skipped");
+	TEST_ASSERT_EQUAL_MESSAGE(2, log[1].index, "Next callable event");
+	TEST_ASSERT_EQUAL_MESSAGE(1000, log[3].time, "Cycle");
+	TEST_ASSERT_EQUAL_MESSAGE(500, chain.getCurrentOffset(), "Offset");
+
+	// Offsets agree with the run
+	chain.stop();
+	log.clear();
+	chain.startAt(1250);
+	TEST_ASSERT_EQUAL_MESSAGE(3, chain.getCurrentEvent(), "Pending event");
+	TEST_ASSERT_EQUAL_MESSAGE(150, chain.getTimeUntilNextEvent(),
+							  "Remainder of the delay");
+	TEST_ASSERT_EQUAL_MESSAGE(250, chain.getCurrentOffset(), "Offset");
+	chain.stop();
+	chain.startAt(50);
+	TEST_ASSERT_EQUAL_MESSAGE(2, chain.getCurrentEvent(), "Never the skipped");
+	TEST_ASSERT_EQUAL_MESSAGE(50, chain.getTimeUntilNextEvent(), "Delay");
+	chain.stop();
+
+	// So do the timeline and the analysis
+	EspEventTimeline timeline;
+	TEST_ASSERT_TRUE(timeline.compile({&chain}));
+	TEST_ASSERT_EQUAL_MESSAGE(1000, timeline.getHyperperiod(), "Cycle");
+	TEST_ASSERT_EQUAL_MESSAGE(3, timeline.numSteps(), "Steps");
+	TEST_ASSERT_EQUAL_MESSAGE(400, timeline.getStep(2).offset, "Offset");
+	EspEventAnalysis analysis;
+	analysis.add(chain);
+	TEST_ASSERT_EQUAL_MESSAGE(3, analysis.numSteps(), "Steps");
+	TEST_ASSERT_EQUAL_MESSAGE(400000, analysis.getStep(2).offset_us,
+							  "Offset");
+
+	// Time only on skipped events is no time at all
+	EspEventChain spins(EspEvent(0, record, &log), EspEvent());
+	spins.changeTimeOf(1, 100);
+	spins.start();
+	TEST_ASSERT_FALSE_MESSAGE(spins.isRunning(), "Refused");
+}
+
+void pauseSelf(EspEventContext &context) {
+	record(context);
+	context.getChain()->pause();
+}
+
+void pause_resume() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+	EspEventChain chain(CHAIN(log));
+	sim.add(chain);
+
+	chain.start();
+	sim.run(130);
+	chain.pause();
+	TEST_ASSERT_TRUE_MESSAGE(chain.isPaused(), "Paused");
+	TEST_ASSERT_FALSE_MESSAGE(chain.isRunning(), "Not running");
+	TEST_ASSERT_EQUAL_MESSAGE(270, chain.getTimeUntilNextEvent(), "Remaining");
+	TEST_ASSERT_EQUAL_MESSAGE(130, chain.getCurrentOffset(), "Offset kept");
+
+	// Nothing runs while paused, then the pending event keeps its phase
+	sim.run(5000);
+	TEST_ASSERT_EQUAL_MESSAGE(3, log.size(), "Nothing run while paused");
+	chain.resume();
+	sim.run(300);
+	TEST_ASSERT_EQUAL_MESSAGE(4, log.size(), "Pending event run");
+	TEST_ASSERT_EQUAL_MESSAGE(3, log[3].index, "Same event");
+	TEST_ASSERT_EQUAL_MESSAGE(5400, log[3].time, "After the remaining time");
+
+	chain.pause();
+	chain.stop();
+	chain.resume();
+	TEST_ASSERT_FALSE_MESSAGE(chain.isRunning(), "Stop discards the pause");
+
+	// Pausing from a callback keeps the delay before the following event
+	log.clear();
+	EspEventChain self(EspEvent(100, pauseSelf, &log),
+					   EspEvent(40, record, &log));
+	sim.add(self);
+	self.start();
+	sim.run(10);
+	TEST_ASSERT_TRUE_MESSAGE(self.isPaused(), "Paused by callback");
+	TEST_ASSERT_EQUAL_MESSAGE(1, self.getCurrentEvent(), "Moved past event");
+	TEST_ASSERT_EQUAL_MESSAGE(40, self.getTimeUntilNextEvent(), "Delay kept");
+}
+
+void time_scale() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+	EspEventChain chain(EspEvent(100, record, &log));
+	sim.add(chain);
+	chain.start();
+
+	sim.run(250);
+	TEST_ASSERT_EQUAL_MESSAGE(3, log.size(), "Normal speed");
+
+	// The pending event keeps its deadline, the following ones are scaled
+	chain.setTimeScale(2.0);
+	sim.run(550);
+	TEST_ASSERT_EQUAL_MESSAGE(6, log.size(), "Half speed");
+	TEST_ASSERT_EQUAL_MESSAGE(700, log[5].time, "Scaled delay");
+	TEST_ASSERT_EQUAL_MESSAGE(50, chain.getCurrentOffset(), "Nominal offset");
+
+	EspEventChain::setGlobalTimeScale(0.25);
+	TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-4, 0.25,
+									 EspEventChain::getGlobalTimeScale(),
+									 "Global scale");
+	sim.run(200);
+	TEST_ASSERT_EQUAL_MESSAGE(900, log[6].time, "Pending event unchanged");
+	TEST_ASSERT_EQUAL_MESSAGE(950, log[7].time, "Both scales applied");
+	EspEventChain::setGlobalTimeScale(1.0);
+	chain.setTimeScale(1.0);
+	TEST_ASSERT_EQUAL_MESSAGE(100, chain.getTotalTime(), "Events unchanged");
+}
+
+void extreme_time_scale() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+
+	// Each scale alone is too fine for 16.16, their product is not
+	EspEventChain precise(EspEvent(100000, record, &log));
+	sim.add(precise);
+	precise.setTimeScale(1.0f / 65536);
+	EspEventChain::setGlobalTimeScale(1.5);
+	precise.start();
+	sim.run(3);
+	TEST_ASSERT_EQUAL_MESSAGE(2, log.size(), "Events run");
+	TEST_ASSERT_EQUAL_MESSAGE(2, log[1].time, "100 s at 1.5 / 65536");
+	precise.stop();
+	sim.remove(precise);
+
+	// Delays too short to scale take a millisecond rather than none
+	log.clear();
+	EspEventChain tiny(EspEvent(100, record, &log));
+	sim.add(tiny);
+	tiny.setTimeScale(1.0f / 512);
+	EspEventChain::setGlobalTimeScale(1.0f / 256);
+	tiny.start();
+	sim.run(10);
+	TEST_ASSERT_TRUE_MESSAGE(log.size() >= 10 && log.size() <= 11,
+							 "One event per millisecond");
+	TEST_ASSERT_TRUE_MESSAGE(tiny.getCurrentOffset() < 100, "Offset");
+	tiny.stop();
+
+	EspEventChain::setGlobalTimeScale(1.0);
+}
+
+void spin(EspEventContext &context) {
+	const unsigned long start = EspEventClock::nowMicros();
+	while (EspEventClock::nowMicros() - start < 3000) {
+	}
+}
+
+static size_t sOverrunPos;
+static unsigned long sOverrunUs;
+
+void onOverrun(EspEventChain &chain, size_t pos, unsigned long elapsed_us) {
+	sOverrunPos = pos;
+	sOverrunUs = elapsed_us;
+}
+
+/* Runs a chain whose first callback takes 3 ms against a 1 ms budget on the
+ * real clock, returning the events recorded after it */
+size_t runOverrunning(EspEventChain::overrun_policy_t policy,
+					  EspEventChain &chain) {
+	std::vector<Fired> log;
+	EspEventDispatcher dispatcher;
+	chain = EspEventChain(EspEvent(10, spin), EspEvent(10, record, &log),
+						  EspEvent(10, record, &log));
+	chain.setCostOf(0, 1000);
+	chain.resetOverruns();
+	chain.setOverrunPolicy(policy);
+	chain.setOverrunHook(onOverrun);
+	dispatcher.add(chain);
+	chain.start();
+
+	// Two passes through the chain
+	const unsigned long end = EspEventClock::now() + 500;
+	while (chain.isRunning() && chain.getCycles() < 2 &&
+		   (long)(EspEventClock::now() - end) < 0) {
+		dispatcher.runDue();
+	}
+	dispatcher.remove(chain);
+	return log.size();
+}
+
+void overrun_watchdog() {
+	EspEventChain chain;
+	sOverrunUs = 0;
+	size_t ran = runOverrunning(EspEventChain::OVERRUN_SHORTEN_NEXT, chain);
+	TEST_ASSERT_EQUAL_MESSAGE(4, ran, "Every event runs");
+	TEST_ASSERT_EQUAL_MESSAGE(2, chain.getOverruns(), "Overruns counted");
+	TEST_ASSERT_EQUAL_MESSAGE(0, sOverrunPos, "Hook given the event");
+	TEST_ASSERT_TRUE_MESSAGE(sOverrunUs >= 3000, "Hook given the time");
+
+	ran = runOverrunning(EspEventChain::OVERRUN_SKIP_NEXT, chain);
+	TEST_ASSERT_EQUAL_MESSAGE(2, ran, "Following event skipped");
+	ran = runOverrunning(EspEventChain::OVERRUN_STOP, chain);
+	TEST_ASSERT_EQUAL_MESSAGE(0, ran, "Chain stopped");
+	TEST_ASSERT_EQUAL_MESSAGE(1, chain.getOverruns(), "Stopped after first");
+}
+
+void shared_pattern() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+	EspEventChain pattern(500);
+	for (size_t i = 0; i < 500; i++) {
+		pattern.push_back(EspEvent(10, record, &log));
+	}
+	pattern.setCostOf(0, 50);
+
+	// One pattern for every channel, each with its own position
+	std::vector<EspEventChain> channels(100, pattern);
+	for (size_t i = 0; i < channels.size(); i++) {
+		sim.add(channels[i]);
+		channels[i].startFrom(i);
+	}
+	sim.run(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(100 * 100, log.size(), "Every channel ran");
+	TEST_ASSERT_EQUAL_MESSAGE(199, channels[99].getCurrentEvent(),
+							  "Own position");
+	for (EspEventChain &channel : channels) {
+		TEST_ASSERT_TRUE_MESSAGE(channel.sharesEventsWith(pattern),
+								 "Events stored once");
+	}
+
+	// Changing one channel copies its events and leaves the rest alone
+	channels[0].changeTimeOf(0, 20);
+	TEST_ASSERT_FALSE_MESSAGE(channels[0].sharesEventsWith(pattern), "Copied");
+	TEST_ASSERT_TRUE_MESSAGE(channels[1].sharesEventsWith(pattern),
+							 "Others still shared");
+	TEST_ASSERT_EQUAL_MESSAGE(10, pattern.getTimeOf(0), "Pattern unchanged");
+	TEST_ASSERT_EQUAL_MESSAGE(20, channels[0].getTimeOf(0), "Copy changed");
+
+	// Costs and signals are shared with the events
+	TEST_ASSERT_EQUAL_MESSAGE(50, channels[1].getCostOf(0), "Shared cost");
+	channels[1].setCostOf(1, 75);
+	TEST_ASSERT_FALSE_MESSAGE(channels[1].sharesEventsWith(pattern),
+							  "Copied for the cost");
+	TEST_ASSERT_EQUAL_MESSAGE(0, pattern.getCostOf(1), "Pattern unchanged");
+	channels[2].setSignalOf(1, "ready");
+	TEST_ASSERT_FALSE_MESSAGE(channels[2].sharesEventsWith(pattern),
+							  "Copied for the signal");
+	TEST_ASSERT_NULL_MESSAGE(pattern.getSignalOf(1), "Pattern unchanged");
+	TEST_ASSERT_TRUE(channels[3].sharesEventsWith(pattern));
+}
+
+#if __ESP_EVENT_CHECK_POLICY__ == __ESP_EVENT_CHECK_ERROR__
+void bad_index_reported() {
+	std::vector<Fired> log;
+	EspEventChain chain(CHAIN(log));
+
+	TEST_ASSERT_EQUAL_MESSAGE(0, chain.getTimeOf(4), "Neutral value");
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventChain::ERROR_BAD_INDEX,
+							  chain.getLastError(), "Bad index recorded");
+	chain.clearError();
+
+	chain.remove(9);
+	chain.startFrom(4);
+	TEST_ASSERT_EQUAL_MESSAGE(4, chain.numEvents(), "Nothing removed");
+	TEST_ASSERT_FALSE_MESSAGE(chain.isRunning(), "Not started");
+	TEST_ASSERT_EQUAL_MESSAGE(-1, chain.getPositionFromHandle(nullptr),
+							  "Null handle");
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventChain::ERROR_NULL_POINTER,
+							  chain.getLastError(), "Last failure kept");
+
+	chain.clearError();
+	TEST_ASSERT_EQUAL_MESSAGE(1000, chain.getTotalTimeBefore(4), "End is valid");
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventChain::ERROR_NONE, chain.getLastError(),
+							  "No error");
+}
+#endif
+
+void accessor_cost() {
+	const size_t NUM_EVENTS = 1000;
+	EspEventChain chain(NUM_EVENTS);
+	for (size_t i = 0; i < NUM_EVENTS; i++) {
+		chain.push_back(EspEvent(i % 7 + 1, record, nullptr));
+	}
+
+	// getTotalTimeBefore() of every position, the worst case loop
+	auto start = std::chrono::steady_clock::now();
+	unsigned long sum = 0;
+	for (size_t i = 0; i <= NUM_EVENTS; i++) sum += chain.getTotalTimeBefore(i);
+	const double before_ns = std::chrono::duration<double, std::nano>(
+								 std::chrono::steady_clock::now() - start)
+								 .count() /
+							 (NUM_EVENTS * (NUM_EVENTS + 1) / 2);
+
+	start = std::chrono::steady_clock::now();
+	unsigned long total = 0;
+	for (size_t rep = 0; rep < 1000; rep++) {
+		for (size_t i = 0; i < NUM_EVENTS; i++) total += chain.getTimeOf(i);
+	}
+	const double get_ns = std::chrono::duration<double, std::nano>(
+							  std::chrono::steady_clock::now() - start)
+							  .count() /
+						  (NUM_EVENTS * 1000);
+
+	char msg[128];
+	snprintf(msg, sizeof(msg),
+			 "policy %i: %.2f ns/event summed, %.2f ns/getTimeOf()",
+			 __ESP_EVENT_CHECK_POLICY__, before_ns, get_ns);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_EQUAL_MESSAGE(chain.getTotalTime() * 1000, total, "Sum");
+	TEST_ASSERT_TRUE_MESSAGE(sum > 0, "Sum of totals");
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(start_at_offset);
+	RUN_TEST(seek_running_chain);
+	RUN_TEST(skipped_events);
+	RUN_TEST(pause_resume);
+	RUN_TEST(time_scale);
+	RUN_TEST(extreme_time_scale);
+	RUN_TEST(shared_pattern);
+	RUN_TEST(overrun_watchdog);
+#if __ESP_EVENT_CHECK_POLICY__ == __ESP_EVENT_CHECK_ERROR__
+	RUN_TEST(bad_index_reported);
+#endif
+	RUN_TEST(accessor_cost);
+	UNITY_END();
+	return 0;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifdef UNIT_TEST
+
+#include <stdio.h>
+#include "EspEventChain.h"
+#include "EspEventChainGroup.h"
+#include "EspEventSimulator.h"
+#include "unity.h"
+
+struct Phase {
+	unsigned long epoch;
+	unsigned long phase;
+	unsigned long period;
+	unsigned long runs;
+	unsigned long max_error;
+};
+
+void checkPhase(EspEventContext &context) {
+	Phase *phase = context.getPayload<Phase>();
+	const unsigned long expected =
+		phase->epoch + phase->phase + phase->runs * phase->period;
+	const long diff = (long)(context.getStartTime() - expected);
+	const unsigned long error = diff < 0 ? -diff : diff;
+	if (error > phase->max_error) phase->max_error = error;
+	phase->runs++;
+}
+
+void phase_locked_for_days() {
+	const unsigned long DAYS_MS = 2 * 24 * 3600000UL;
+
+	EspEventSimulator sim;
+	Phase phases[] = {{0, 0, 100}, {0, 33, 100}, {0, 66, 250}};
+	EspEventChain chains[] = {
+		EspEventChain(EspEvent(phases[0].period, checkPhase, &phases[0])),
+		EspEventChain(EspEvent(phases[1].period, checkPhase, &phases[1])),
+		EspEventChain(EspEvent(phases[2].period, checkPhase, &phases[2]))};
+
+	EspEventChainGroup group;
+	for (size_t i = 0; i < 3; i++) {
+		sim.add(chains[i]);
+		group.add(chains[i], phases[i].phase);
+	}
+	TEST_ASSERT_EQUAL(3, group.size());
+	TEST_ASSERT_EQUAL(33, group.getPhaseOf(chains[1]));
+
+	// Some time passes before the start, and the epoch is later still
+	sim.run(17);
+	group.start(5);
+	TEST_ASSERT_EQUAL(22, group.getEpoch());
+	for (Phase &phase : phases) phase.epoch = group.getEpoch();
+	sim.run(DAYS_MS);
+
+	char msg[128];
+	snprintf(msg, sizeof(msg),
+			 "%lu, %lu, %lu runs over 2 days, phase error %lu, %lu, %lu ms",
+			 phases[0].runs, phases[1].runs, phases[2].runs,
+			 phases[0].max_error, phases[1].max_error, phases[2].max_error);
+	TEST_MESSAGE(msg);
+	for (const Phase &phase : phases) {
+		TEST_ASSERT_EQUAL_MESSAGE(0, phase.max_error, "Phase-locked");
+		TEST_ASSERT_EQUAL_MESSAGE(
+			(DAYS_MS + 17 - phase.epoch - phase.phase - 1) / phase.period + 1,
+			phase.runs, "Every run made");
+	}
+
+	group.stop();
+	TEST_ASSERT_FALSE_MESSAGE(group.isRunning(), "All stopped");
+	TEST_ASSERT_EQUAL_MESSAGE(0, sim.run(1000), "Nothing left queued");
+}
+
+void restart_realigns() {
+	EspEventSimulator sim;
+	Phase phases[] = {{0, 0, 100}, {0, 50, 100}};
+	EspEventChain a(EspEvent(100, checkPhase, &phases[0]));
+	EspEventChain b(EspEvent(100, checkPhase, &phases[1]));
+	sim.add(a);
+	sim.add(b);
+
+	// Started one at a time, the second chain lands 30 ms out of phase
+	a.start();
+	sim.run(80);
+	b.start();
+	sim.run(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(30, phases[1].max_error, "Drifted start");
+
+	EspEventChainGroup group;
+	group.add(a, 0);
+	group.add(b, 50);
+	group.start();
+	for (Phase &phase : phases) {
+		phase.epoch = group.getEpoch();
+		phase.runs = 0;
+		phase.max_error = 0;
+	}
+	sim.run(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(0, phases[0].max_error, "Realigned");
+	TEST_ASSERT_EQUAL_MESSAGE(0, phases[1].max_error, "Realigned");
+	TEST_ASSERT_EQUAL(10, phases[1].runs);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(phase_locked_for_days);
+	RUN_TEST(restart_realigns);
+	UNITY_END();
+	return 0;
+}
+
+#endif
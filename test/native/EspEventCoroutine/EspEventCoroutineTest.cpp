@@ -0,0 +1,223 @@
+#ifdef UNIT_TEST
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "EspEventChain.h"
+#include "EspEventCoroutine.h"
+#include "EspEventSimulator.h"
+#include "unity.h"
+
+#if __ESP_EVENT_COROUTINE__
+
+using namespace std::chrono_literals;
+
+// Counts heap allocations made by the code under test
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+	allocations++;
+	void *ptr = malloc(size ? size : 1);
+	if (ptr == nullptr) throw std::bad_alloc();
+	return ptr;
+}
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t size) noexcept { free(ptr); }
+
+struct Steps {
+	std::vector<unsigned long> times;
+	bool signaled;
+	bool timed_out;
+};
+
+EspEventCoroutine sequence(Steps &steps) {
+	steps.times.push_back(EspEventClock::now());
+	co_await EspEventCoroutine::sleep(20ms);
+	steps.times.push_back(EspEventClock::now());
+	steps.signaled = co_await EspEventCoroutine::signal("ready");
+	steps.times.push_back(EspEventClock::now());
+	steps.timed_out = !co_await EspEventCoroutine::signal("never", 50);
+	steps.times.push_back(EspEventClock::now());
+}
+
+void raiseReady(EspEventContext &context) {
+	context.getPayload<EspEventDispatcher>()->raise("ready");
+}
+
+void nothing(EspEventContext &context) {}
+
+void sleeps_and_signals() {
+	EspEventSimulator sim;
+	Steps steps = {};
+	EspEventCoroutine task = sequence(steps);
+	TEST_ASSERT_TRUE_MESSAGE(task.isValid(), "Frame from the pool");
+	TEST_ASSERT_EQUAL(EspEventCoroutinePool::FRAMES - 1,
+					  EspEventCoroutinePool::numFree());
+
+	// Raises "ready" at 100 ms
+	EspEventChain sensor(EspEvent(0, nothing),
+						 EspEvent(100, raiseReady, &sim.getDispatcher()));
+	sim.add(task.getChain());
+	sim.add(sensor);
+	task.start();
+	sensor.runOnce();
+	sim.run(1000);
+
+	const unsigned long expected[] = {0, 20, 100, 150};
+	TEST_ASSERT_EQUAL_MESSAGE(4, steps.times.size(), "Every step ran");
+	for (size_t i = 0; i < 4; i++) {
+		TEST_ASSERT_EQUAL_MESSAGE(expected[i], steps.times[i],
+								  "Resumed at virtual time");
+	}
+	TEST_ASSERT_TRUE_MESSAGE(steps.signaled, "Resumed by the signal");
+	TEST_ASSERT_TRUE_MESSAGE(steps.timed_out, "Resumed by the timeout");
+	TEST_ASSERT_TRUE_MESSAGE(task.done(), "Returned");
+	TEST_ASSERT_FALSE_MESSAGE(task.getChain().isRunning(), "Chain stopped");
+	TEST_ASSERT_EQUAL_MESSAGE(4, sim.getReport(task.getChain()).events,
+							  "One event per resume");
+
+	sim.remove(task.getChain());
+	task = EspEventCoroutine(nullptr);
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventCoroutinePool::FRAMES,
+							  EspEventCoroutinePool::numFree(),
+							  "Frame returned");
+}
+
+EspEventCoroutine idle() { co_await EspEventCoroutine::sleep(1); }
+
+void pool_exhausted() {
+	std::vector<EspEventCoroutine> tasks;
+	for (size_t i = 0; i < EspEventCoroutinePool::FRAMES; i++) {
+		tasks.push_back(idle());
+		TEST_ASSERT_TRUE(tasks.back().isValid());
+	}
+	EspEventCoroutine extra = idle();
+	TEST_ASSERT_FALSE_MESSAGE(extra.isValid(), "No heap fallback");
+
+	tasks.pop_back();
+	extra = idle();
+	TEST_ASSERT_TRUE_MESSAGE(extra.isValid(), "Freed frame reused");
+}
+
+EspEventCoroutine waits(uint32_t &count) {
+	for (;;) {
+		count++;
+		co_await EspEventCoroutine::sleep(3);
+		count++;
+		co_await EspEventCoroutine::signal("never", 2);
+		count++;
+		co_await EspEventCoroutine::signal("ready");
+	}
+}
+
+void allocations_per_resume() {
+	EspEventSimulator sim;
+	EspEventChain sensor(EspEvent(5, raiseReady, &sim.getDispatcher()));
+	sim.add(sensor);
+	sensor.start();
+
+	// Only the chain's events come from the heap, the frame is pooled
+	size_t before = allocations;
+	uint32_t count = 0;
+	EspEventCoroutine task = waits(count);
+	const size_t created = allocations - before;
+	char msg[64];
+	snprintf(msg, sizeof(msg), "%u allocations to create", (unsigned)created);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_TRUE_MESSAGE(created > 0, "Chain events on the heap");
+
+	// Up to the first sleep, so the dispatcher queue has grown to size
+	sim.add(task.getChain());
+	task.start();
+	sim.run(1);
+	TEST_ASSERT_EQUAL(1, count);
+
+	before = allocations;
+	const uint32_t resumed = count;
+	sim.run(10000);
+	TEST_ASSERT_TRUE_MESSAGE(count - resumed > 1000, "Resumed often");
+	TEST_ASSERT_EQUAL_MESSAGE(0, allocations - before,
+							  "No allocation per resume");
+	sim.remove(task.getChain());
+}
+
+EspEventCoroutine toggle(uint32_t &count) {
+	for (;;) {
+		count++;
+		co_await EspEventCoroutine::sleep(1);
+		count++;
+		co_await EspEventCoroutine::sleep(2);
+	}
+}
+
+void increment(EspEventContext &context) {
+	(*context.getPayload<uint32_t>())++;
+}
+
+/* Wall time per event of simulating a chain for duration_ms */
+static double nsPerEvent(EspEventChain &chain, unsigned long duration_ms,
+						 size_t *events) {
+	EspEventSimulator sim;
+	sim.add(chain);
+	chain.start();
+	const auto start = std::chrono::steady_clock::now();
+	*events = sim.run(duration_ms);
+	const double ns = std::chrono::duration<double, std::nano>(
+						  std::chrono::steady_clock::now() - start)
+						  .count();
+	sim.remove(chain);
+	return ns / *events;
+}
+
+void versus_chain() {
+	const unsigned long DURATION_MS = 3000000;
+
+	uint32_t chain_count = 0;
+	EspEventChain chain(EspEvent(2, increment, &chain_count),
+						EspEvent(1, increment, &chain_count));
+	size_t chain_events;
+	const double chain_ns = nsPerEvent(chain, DURATION_MS, &chain_events);
+
+	uint32_t coroutine_count = 0;
+	EspEventCoroutine task = toggle(coroutine_count);
+	size_t coroutine_events;
+	const double coroutine_ns =
+		nsPerEvent(task.getChain(), DURATION_MS, &coroutine_events);
+
+	char msg[128];
+	snprintf(msg, sizeof(msg),
+			 "%u events: chain %.1f ns / event, coroutine %.1f ns / event",
+			 (unsigned)chain_events, chain_ns, coroutine_ns);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_EQUAL_MESSAGE(chain_events, coroutine_events,
+							  "Same schedule");
+	TEST_ASSERT_EQUAL_MESSAGE(chain_count, coroutine_count, "Same work");
+	TEST_ASSERT_TRUE_MESSAGE(coroutine_ns < chain_ns * 5 + 100,
+							 "Resuming stays cheap");
+}
+
+#else
+
+void coroutines_unsupported() {
+	TEST_IGNORE_MESSAGE("Needs a compiler with C++20 coroutines");
+}
+
+#endif
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+#if __ESP_EVENT_COROUTINE__
+	RUN_TEST(sleeps_and_signals);
+	RUN_TEST(pool_exhausted);
+	RUN_TEST(allocations_per_resume);
+	RUN_TEST(versus_chain);
+#else
+	RUN_TEST(coroutines_unsupported);
+#endif
+	UNITY_END();
+	return 0;
+}
+
+#endif
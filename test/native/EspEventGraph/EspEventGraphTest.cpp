@@ -0,0 +1,147 @@
+#ifdef UNIT_TEST
+
+#include <stdio.h>
+#include "EspEventChain.h"
+#include "EspEventGraph.h"
+#include "EspEventSimulator.h"
+#include "unity.h"
+
+void nothing(EspEventContext &context) {}
+
+/* A stage whose pass ends duration_ms after it starts */
+static EspEventChain stage(unsigned long duration_ms) {
+	return EspEventChain(EspEvent(0, nothing), EspEvent(duration_ms, nothing));
+}
+
+void recordDone(EspEventGraph &graph, void *arg) {
+	*static_cast<unsigned long *>(arg) = EspEventClock::now();
+}
+
+void pipeline_latency() {
+	EspEventSimulator sim;
+	EspEventChain warm_up = stage(50);
+	EspEventChain sample_a = stage(10), sample_b = stage(20),
+				  sample_c = stage(30);
+	EspEventChain aggregate = stage(5);
+	EspEventChain transmit = stage(15);
+	EspEventChain *stages[] = {&warm_up,   &sample_a,  &sample_b,
+							   &sample_c,  &aggregate, &transmit};
+	for (EspEventChain *chain : stages) sim.add(*chain);
+
+	// Added out of order, so validate() has something to sort
+	EspEventGraph graph;
+	graph.addEdge(aggregate, transmit);
+	graph.addEdge(sample_a, aggregate);
+	graph.addEdge(sample_b, aggregate);
+	graph.addEdge(sample_c, aggregate);
+	graph.addEdge(warm_up, sample_a);
+	graph.addEdge(warm_up, sample_b);
+	graph.addEdge(warm_up, sample_c);
+	TEST_ASSERT_TRUE_MESSAGE(graph.validate(), "Acyclic");
+	TEST_ASSERT_TRUE_MESSAGE(&graph.getOrdered(0) == &warm_up, "Root first");
+	TEST_ASSERT_TRUE(&graph.getOrdered(4) == &aggregate);
+	TEST_ASSERT_TRUE(&graph.getOrdered(5) == &transmit);
+
+	unsigned long done_ms = 0;
+	graph.setDoneHook(recordDone, &done_ms);
+	TEST_ASSERT_TRUE(graph.start());
+	TEST_ASSERT_TRUE_MESSAGE(warm_up.isRunning(), "Root started");
+	TEST_ASSERT_FALSE_MESSAGE(aggregate.isRunning(), "Fan-in waits");
+	sim.run(1000);
+
+	// Critical path: warm up, slowest sample, aggregate, transmit
+	char msg[64];
+	snprintf(msg, sizeof(msg), "end to end latency %lu ms", done_ms);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_EQUAL_MESSAGE(50 + 30 + 5 + 15, done_ms, "No gaps");
+	TEST_ASSERT_FALSE(graph.isRunning());
+	TEST_ASSERT_EQUAL(1, graph.getRuns());
+	TEST_ASSERT_EQUAL_MESSAGE(12, sim.getTotals().events, "Each stage once");
+
+	// A second run starts from the roots again
+	TEST_ASSERT_TRUE(graph.start());
+	sim.run(1000);
+	TEST_ASSERT_EQUAL(2, graph.getRuns());
+	TEST_ASSERT_EQUAL(1000 + 100, done_ms);
+}
+
+void rejects_cycle() {
+	EspEventChain a = stage(10), b = stage(10), c = stage(10);
+	EspEventGraph graph;
+	graph.addEdge(a, b);
+	graph.addEdge(b, c);
+	graph.addEdge(c, b);
+	TEST_ASSERT_FALSE_MESSAGE(graph.addEdge(a, a), "Self loop");
+	TEST_ASSERT_FALSE_MESSAGE(graph.validate(), "Cycle found");
+	TEST_ASSERT_FALSE_MESSAGE(graph.start(), "Not started");
+	TEST_ASSERT_FALSE(a.isRunning());
+}
+
+void stage_not_started() {
+	EspEventSimulator sim;
+	EspEventChain first = stage(10), last = stage(10);
+	EspEventChain idle(EspEvent(0, nothing));
+	EspEventChain *stages[] = {&first, &idle, &last};
+	for (EspEventChain *chain : stages) sim.add(*chain);
+
+	// A chain with no time refuses to start, so last would never run
+	EspEventGraph graph;
+	graph.addEdge(first, idle);
+	graph.addEdge(idle, last);
+	unsigned long done_ms = 0;
+	graph.setDoneHook(recordDone, &done_ms);
+	TEST_ASSERT_TRUE(graph.start());
+	sim.run(100);
+	TEST_ASSERT_FALSE_MESSAGE(graph.isRunning(), "Run abandoned");
+	TEST_ASSERT_EQUAL(1, graph.getFailures());
+	TEST_ASSERT_EQUAL(0, graph.getRuns());
+	TEST_ASSERT_EQUAL_MESSAGE(0, done_ms, "Not done");
+	TEST_ASSERT_FALSE(last.isRunning());
+
+	// Nor can a run begin from such a stage
+	EspEventGraph rooted;
+	rooted.addEdge(idle, last);
+	TEST_ASSERT_FALSE_MESSAGE(rooted.start(), "Root did not start");
+	TEST_ASSERT_FALSE(rooted.isRunning());
+	TEST_ASSERT_EQUAL(1, rooted.getFailures());
+}
+
+void countPass(EspEventChain &chain, void *count) {
+	(*static_cast<int *>(count))++;
+}
+
+void keeps_completion_hooks() {
+	EspEventSimulator sim;
+	EspEventChain first = stage(10), last = stage(10);
+	sim.add(first);
+	sim.add(last);
+	int first_passes = 0, last_passes = 0;
+	first.setCompletionHook(countPass, &first_passes);
+	last.setCompletionHook(countPass, &last_passes);
+
+	EspEventGraph graph;
+	graph.addEdge(first, last);
+	TEST_ASSERT_TRUE(graph.start());
+	sim.run(100);
+	TEST_ASSERT_EQUAL(1, graph.getRuns());
+	TEST_ASSERT_EQUAL_MESSAGE(1, first_passes, "Hook ran during the run");
+	TEST_ASSERT_EQUAL(1, last_passes);
+
+	// Still in place once the graph is done with the chains
+	first.runOnce();
+	sim.run(100);
+	TEST_ASSERT_EQUAL_MESSAGE(2, first_passes, "Hook kept after the run");
+	TEST_ASSERT_FALSE_MESSAGE(last.isRunning(), "Graph hook not left over");
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(pipeline_latency);
+	RUN_TEST(rejects_cycle);
+	RUN_TEST(stage_not_started);
+	RUN_TEST(keeps_completion_hooks);
+	UNITY_END();
+	return 0;
+}
+
+#endif
@@ -0,0 +1,250 @@
+#ifdef UNIT_TEST
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include <thread>
+#include <time.h>
+#include "EspEventChain.h"
+#include "EspEventLinuxLoop.h"
+#include "unity.h"
+
+struct Jitter {
+	uint64_t events;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
+static uint64_t monotonicUs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void measure(EspEventContext &context) {
+	Jitter *jitter = context.getPayload<Jitter>();
+	const uint64_t late_us = monotonicUs() - context.getScheduledTime() * 1000;
+	jitter->events++;
+	jitter->total_us += late_us;
+	if (late_us > jitter->max_us) jitter->max_us = late_us;
+}
+
+void stopLoop(EspEventContext &context) {
+	context.getPayload<EspEventLinuxLoop>()->stop();
+}
+
+void nothing(EspEventContext &context) {}
+
+/* Chain that stops the loop once duration_ms has passed */
+static EspEventChain stopAfter(EspEventLinuxLoop &loop,
+							   unsigned long duration_ms) {
+	return EspEventChain(EspEvent(0, nothing),
+						 EspEvent(duration_ms, stopLoop, &loop));
+}
+
+void runs_chains() {
+	EspEventLinuxLoop loop;
+	TEST_ASSERT_TRUE_MESSAGE(loop.isValid(), "Descriptors opened");
+
+	Jitter jitter = {};
+	EspEventChain chain(EspEvent(20, measure, &jitter),
+						EspEvent(30, measure, &jitter));
+	EspEventChain stopper = stopAfter(loop, 245);
+	loop.add(chain);
+	loop.add(stopper);
+	chain.start();
+	stopper.start();
+
+	TEST_ASSERT_TRUE_MESSAGE(loop.run(), "Loop exits without error");
+
+	// The ten events due before the stopper run ahead of it however late
+	// the loop wakes, and a late loop may run a few more
+	char msg[64];
+	snprintf(msg, sizeof(msg), "%llu events, max lateness %llu us",
+			 (unsigned long long)jitter.events,
+			 (unsigned long long)jitter.max_us);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_TRUE_MESSAGE(jitter.events >= 10, "Every due event ran");
+	TEST_ASSERT_TRUE_MESSAGE(chain.isRunning(), "Chain still running");
+}
+
+void stop_from_thread() {
+	EspEventLinuxLoop loop;
+	std::thread stopper([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		loop.stop();
+	});
+
+	// No chain is running, so the loop sleeps until woken
+	TEST_ASSERT_TRUE_MESSAGE(loop.run(), "Loop woken by stop()");
+	stopper.join();
+	TEST_ASSERT_EQUAL_MESSAGE(0, loop.getWakeups(), "Timer never armed");
+}
+
+void stampTime(EspEventContext &context) {
+	*context.getPayload<uint64_t>() = monotonicUs();
+}
+
+void trigger_from_thread() {
+	EspEventLinuxLoop loop;
+	uint64_t ran_us = 0;
+	EspEventChain chain(EspEvent(1000, stampTime, &ran_us),
+						EspEvent(1000, stopLoop, &loop));
+	loop.add(chain);
+
+	// Nothing is queued, so only the wake hook can get the loop to react
+	uint64_t triggered_us = 0, advanced_us = 0;
+	std::thread isr([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		triggered_us = monotonicUs();
+		chain.triggerFromISR();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		advanced_us = monotonicUs();
+		chain.advanceFromISR();
+	});
+	TEST_ASSERT_TRUE_MESSAGE(loop.run(), "Loop stopped by advanced event");
+	isr.join();
+
+	char msg[96];
+	snprintf(msg, sizeof(msg), "trigger to first event %llu us",
+			 (unsigned long long)(ran_us - triggered_us));
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_TRUE_MESSAGE(ran_us >= triggered_us, "Started by trigger");
+	TEST_ASSERT_LESS_THAN_MESSAGE(500000, monotonicUs() - advanced_us,
+								  "Second event run early by advance");
+	TEST_ASSERT_FALSE_MESSAGE(chain.isRunning(), "Ran through once");
+}
+
+static unsigned long clockOffset = 0;
+static unsigned long wrappingNow() {
+	return EspEventClock::platformNow() + clockOffset;
+}
+
+void count(EspEventContext &context) { (*context.getPayload<int>())++; }
+
+void clock_wrap() {
+	// Wraps 50 ms into the run, as millis() does every 49.7 days
+	clockOffset = (unsigned long)-50 - EspEventClock::platformNow();
+	EspEventClock::setSource(wrappingNow);
+
+	EspEventLinuxLoop loop;
+	int events = 0;
+	EspEventChain chain(EspEvent(20, count, &events));
+	loop.add(chain);
+	chain.start();
+
+	// Polled with a timeout, so a timer that never fires cannot hang
+	const uint64_t end_us = monotonicUs() + 150000;
+	bool polled = true;
+	while (polled && monotonicUs() < end_us) polled = loop.poll(10) >= 0;
+	EspEventClock::setSource(nullptr);
+	TEST_ASSERT_TRUE_MESSAGE(polled, "poll() without error");
+
+	// A deadline taken as a time in the past would fire the timer at once,
+	// over and over
+	char msg[64];
+	snprintf(msg, sizeof(msg), "%d events, %llu wakeups", events,
+			 (unsigned long long)loop.getWakeups());
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_TRUE_MESSAGE(events >= 6, "Events ran across the wrap");
+	TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(2 * events + 2, loop.getWakeups(),
+									  "No spinning after the wrap");
+}
+
+void isr_cost() {
+	const size_t BATCHES = 1000, BATCH = 1000;
+
+	// A bare dispatcher, as on device where no wake hook is needed
+	EspEventDispatcher dispatcher;
+	EspEventChain chain(EspEvent(10, nothing));
+	dispatcher.add(chain);
+
+	uint64_t total_ns = 0, worst_ns = 0;
+	for (size_t b = 0; b < BATCHES; b++) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < BATCH; i++) chain.triggerFromISR();
+		const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+								std::chrono::steady_clock::now() - start)
+								.count();
+		total_ns += ns;
+		if (ns > worst_ns) worst_ns = ns;
+	}
+
+	char msg[128];
+	snprintf(msg, sizeof(msg),
+			 "triggerFromISR() mean %.1f ns, worst batch mean %.1f ns",
+			 (double)total_ns / (BATCHES * BATCH), (double)worst_ns / BATCH);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_LESS_THAN_MESSAGE(1000, total_ns / (BATCHES * BATCH),
+								  "Trigger only stores a request");
+
+	// A million requests coalesce into one start, made only once serviced
+	TEST_ASSERT_FALSE(chain.isRunning());
+	TEST_ASSERT_TRUE_MESSAGE(dispatcher.empty(), "Queries start nothing");
+	TEST_ASSERT_FALSE(chain.isRunning());
+	dispatcher.serviceISRRequests();
+	TEST_ASSERT_TRUE(chain.isRunning());
+	TEST_ASSERT_FALSE(dispatcher.empty());
+}
+
+/* Benchmark, built only with __ESP_EVENT_SOAK__ as it takes seconds */
+void soak() {
+#ifndef __ESP_EVENT_SOAK__
+	TEST_IGNORE_MESSAGE("Build with -D__ESP_EVENT_SOAK__=1 to run the soak");
+#else
+	const size_t NUM_CHAINS = 20000;
+	const unsigned long DURATION_MS = 3000;
+
+	EspEventLinuxLoop loop;
+	Jitter jitter = {};
+	std::vector<EspEventChain> chains(NUM_CHAINS);
+	for (size_t i = 0; i < NUM_CHAINS; i++) {
+		chains[i].emplace_back(50 + i % 200, measure, &jitter);
+		loop.add(chains[i]);
+	}
+	EspEventChain stopper = stopAfter(loop, DURATION_MS);
+	loop.add(stopper);
+
+	struct rusage before, after;
+	getrusage(RUSAGE_SELF, &before);
+	for (EspEventChain &chain : chains) chain.start();
+	stopper.start();
+	loop.run();
+	getrusage(RUSAGE_SELF, &after);
+
+	const double cpu_s =
+		(after.ru_utime.tv_sec - before.ru_utime.tv_sec) +
+		(after.ru_stime.tv_sec - before.ru_stime.tv_sec) +
+		((after.ru_utime.tv_usec - before.ru_utime.tv_usec) +
+		 (after.ru_stime.tv_usec - before.ru_stime.tv_usec)) /
+			1e6;
+
+	char msg[192];
+	snprintf(msg, sizeof(msg),
+			 "%u chains, %llu events, %llu wakeups, jitter mean %llu us max "
+			 "%llu us, cpu %.1f%%",
+			 (unsigned)NUM_CHAINS, (unsigned long long)jitter.events,
+			 (unsigned long long)loop.getWakeups(),
+			 (unsigned long long)(jitter.total_us / jitter.events),
+			 (unsigned long long)jitter.max_us, 100 * cpu_s * 1000 / DURATION_MS);
+	TEST_MESSAGE(msg);
+
+	TEST_ASSERT_TRUE_MESSAGE(jitter.events >= NUM_CHAINS * (DURATION_MS / 250),
+							 "Every chain ran");
+	TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(DURATION_MS + 1, loop.getWakeups(),
+									  "At most one wakeup per millisecond");
+#endif
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(runs_chains);
+	RUN_TEST(stop_from_thread);
+	RUN_TEST(trigger_from_thread);
+	RUN_TEST(clock_wrap);
+	RUN_TEST(isr_cost);
+	RUN_TEST(soak);
+	UNITY_END();
+	return 0;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifdef UNIT_TEST
+
+#include <chrono>
+#include <stdio.h>
+#include "EspEventChain.h"
+#include "EspEventSimulator.h"
+#include "unity.h"
+
+static int evaluated = 0;
+
+int sideEffect() { return ++evaluated; }
+
+void nothing(EspEventContext &context) {}
+
+void arguments_not_evaluated() {
+	__ESP_EVENT_LOGV__("Value %i", sideEffect());
+#if __ESP_EVENT_LOG_LEVEL__ < __ESP_EVENT_LOG_VERBOSE__
+	TEST_ASSERT_EQUAL_MESSAGE(0, evaluated, "Disabled message removed");
+#else
+	TEST_ASSERT_EQUAL_MESSAGE(1, evaluated, "Enabled message evaluated");
+#endif
+}
+
+void construct_and_dispatch_cost() {
+	const size_t NUM_EVENTS = 1000;
+	const size_t NUM_CHAINS = 100;
+	const size_t logs_before = espEventHostLogCount();
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<EspEventChain> chains(NUM_CHAINS);
+	for (EspEventChain &chain : chains) {
+		for (size_t i = 0; i < NUM_EVENTS; i++) {
+			chain.push_back(EspEvent(1, nothing));
+		}
+	}
+	const double construct_ns =
+		std::chrono::duration<double, std::nano>(
+			std::chrono::steady_clock::now() - start)
+			.count() /
+		(NUM_EVENTS * NUM_CHAINS);
+	const size_t construct_logs = espEventHostLogCount() - logs_before;
+
+	EspEventSimulator sim;
+	for (EspEventChain &chain : chains) {
+		sim.add(chain);
+		chain.start();
+	}
+	start = std::chrono::steady_clock::now();
+	const size_t events = sim.run(10000);
+	const double dispatch_ns = std::chrono::duration<double, std::nano>(
+								   std::chrono::steady_clock::now() - start)
+								   .count() /
+							   events;
+
+	char msg[128];
+	snprintf(msg, sizeof(msg),
+			 "level %i: %.1f ns/push_back, %.1f ns/event, %u log lines",
+			 __ESP_EVENT_LOG_LEVEL__, construct_ns, dispatch_ns,
+			 (unsigned)(espEventHostLogCount() - logs_before));
+	TEST_MESSAGE(msg);
+
+#if __ESP_EVENT_LOG_LEVEL__ < __ESP_EVENT_LOG_INFO__
+	TEST_ASSERT_EQUAL_MESSAGE(0, construct_logs, "No logging by default");
+#elif __ESP_EVENT_LOG_RATE_MS__ == 0
+	TEST_ASSERT_TRUE_MESSAGE(construct_logs >= NUM_EVENTS * NUM_CHAINS,
+							 "A line per event added");
+#else
+	TEST_ASSERT_TRUE_MESSAGE(construct_logs < NUM_CHAINS,
+							 "Rate limited on the virtual clock");
+#endif
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(arguments_not_evaluated);
+	RUN_TEST(construct_and_dispatch_cost);
+	UNITY_END();
+	return 0;
+}
+
+#endif
@@ -0,0 +1,487 @@
+#ifdef UNIT_TEST
+
+#include <chrono>
+#include <stdio.h>
+#include "EspEventChain.h"
+#include "EspEventSimulator.h"
+#include "unity.h"
+
+struct Log {
+	std::vector<unsigned long> times;
+	std::vector<unsigned long> lateness;
+};
+
+void record(EspEventContext &context) {
+	Log *log = context.getPayload<Log>();
+	log->times.push_back(context.getStartTime());
+	log->lateness.push_back(context.getLateness());
+}
+
+void event_timing() {
+	EspEventSimulator sim;
+	Log log;
+	EspEventChain chain(EspEvent(100, record, &log),
+						EspEvent(50, record, &log));
+	sim.add(chain);
+	chain.start();
+
+	sim.run(1000);
+
+	// Event 0 at 0, 150, 300... and event 1 at 50, 200, 350...
+	const unsigned long expected[] = {0, 50, 150, 200, 300, 350, 450};
+	for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+		TEST_ASSERT_EQUAL_MESSAGE(expected[i], log.times[i],
+								  "Events run at their virtual time");
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(14, log.times.size(), "Events in 1000 ms");
+	TEST_ASSERT_EQUAL_MESSAGE(1000000, sim.now(), "Clock at end of run()");
+	TEST_ASSERT_EQUAL_MESSAGE(0, sim.getReport(chain).max_lateness_us,
+							  "No lateness without costs");
+}
+
+void costs_delay_other_chains() {
+	EspEventSimulator sim;
+	Log slow_log, fast_log;
+	EspEventChain slow(EspEvent(100, record, &slow_log));
+	EspEventChain fast(EspEvent(100, record, &fast_log));
+	slow.setCostOf(0, 30000);
+	sim.add(slow);
+	sim.add(fast);
+	slow.start();
+	fast.start();
+
+	sim.run(1000);
+
+	const EspEventSimulator::report_t &slow_report = sim.getReport(slow);
+	const EspEventSimulator::report_t &fast_report = sim.getReport(fast);
+	TEST_ASSERT_EQUAL_MESSAGE(10, slow_report.events, "Slow chain events");
+	TEST_ASSERT_EQUAL_MESSAGE(10, fast_report.events, "Fast chain events");
+	TEST_ASSERT_EQUAL_MESSAGE(0, slow_report.max_lateness_us,
+							  "First chain runs on time");
+	TEST_ASSERT_EQUAL_MESSAGE(30000, fast_report.max_lateness_us,
+							  "Second chain waits for the slow callback");
+	TEST_ASSERT_EQUAL_MESSAGE(10, fast_report.overlaps, "Overlaps counted");
+	TEST_ASSERT_EQUAL_MESSAGE(30, fast_log.lateness[0],
+							  "Context sees lateness in virtual time");
+	TEST_ASSERT_INT_WITHIN_MESSAGE(1, 30, (int)(sim.getUtilization() * 100),
+								   "Utilization");
+}
+
+void backOff(EspEventContext &context) {
+	unsigned long *delay = context.getPayload<unsigned long>();
+	*delay *= 2;
+	context.setNextDelay(*delay);
+}
+
+void dynamic_delay() {
+	EspEventSimulator sim;
+	unsigned long delay = 10;
+	EspEventChain chain(EspEvent(10, backOff, &delay));
+	sim.add(chain);
+	chain.start();
+
+	// Delays of 20, 40, 80 put events at 0, 20, 60, 140, then 300
+	TEST_ASSERT_EQUAL_MESSAGE(4, sim.run(300), "Delay doubles each event");
+	TEST_ASSERT_EQUAL_MESSAGE(10, chain.getTimeOf(0), "Chain not modified");
+}
+
+void run_once_finishes() {
+	EspEventSimulator sim;
+	Log log;
+	EspEventChain chain(EspEvent(20, record, &log), EspEvent(20, record, &log),
+						EspEvent(20, record, &log));
+	sim.add(chain);
+	chain.runOnce();
+
+	sim.run(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(3, log.times.size(), "Each event once");
+	TEST_ASSERT_FALSE_MESSAGE(chain.isRunning(), "Stopped after one pass");
+}
+
+void startNext(EspEventChain &chain, void *next) {
+	static_cast<EspEventChain *>(next)->runOnce();
+}
+
+void run_once_pipeline() {
+	EspEventSimulator sim;
+	Log first_log, second_log, waiter_log;
+	EspEventChain first(EspEvent(10, record, &first_log),
+						EspEvent(10, record, &first_log),
+						EspEvent(10, record, &first_log));
+	EspEventChain second(EspEvent(10, record, &second_log),
+						 EspEvent(15, record, &second_log));
+
+	// Waits for the first chain to complete
+	EspEventChain waiter(EspEvent(5, record, &waiter_log),
+						 EspEvent(0, record, &waiter_log));
+	waiter.setSignalOf(1, "first done");
+	first.setCompletionSignal("first done");
+	sim.add(first);
+	sim.add(second);
+	sim.add(waiter);
+	waiter.runOnce();
+
+	EspEventCompletion done = first.runOnce().then(startNext, &second);
+	TEST_ASSERT_FALSE_MESSAGE(done.isDone(), "Pass under way");
+	sim.run(1000);
+
+	// The second chain starts as the last event of the first one runs
+	const unsigned long first_times[] = {0, 10, 20};
+	const unsigned long second_times[] = {20, 35};
+	for (size_t i = 0; i < 3; i++) {
+		TEST_ASSERT_EQUAL(first_times[i], first_log.times[i]);
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(2, second_log.times.size(), "Second ran once");
+	for (size_t i = 0; i < 2; i++) {
+		TEST_ASSERT_EQUAL_MESSAGE(second_times[i], second_log.times[i],
+								  "No gap between passes");
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(20, waiter_log.times[1], "Signal on completion");
+	TEST_ASSERT_TRUE(done.isDone());
+	TEST_ASSERT_EQUAL(1, first.getCompletions());
+	TEST_ASSERT_EQUAL(1, second.getCompletions());
+}
+
+void countPass(EspEventChain &chain, void *count) {
+	(*static_cast<int *>(count))++;
+}
+
+void run_once_completion() {
+	EspEventSimulator sim;
+	Log log;
+	EspEventChain chain(EspEvent(10, record, &log),
+						EspEvent(10, record, &log));
+	int passes = 0, first = 0, paused = 0;
+	chain.setCompletionHook(countPass, &passes);
+	sim.add(chain);
+
+	// The hook given to a pass runs once, beside the hook of the chain
+	chain.runOnce().then(countPass, &first);
+	sim.run(100);
+	chain.runOnce();
+	sim.run(100);
+	TEST_ASSERT_EQUAL_MESSAGE(2, passes, "Chain hook after every pass");
+	TEST_ASSERT_EQUAL_MESSAGE(1, first, "Pass hook only after its pass");
+
+	// Paused part way, the pass is not over until it is resumed and ends
+	EspEventCompletion done = chain.runOnce().then(countPass, &paused);
+	sim.run(5);
+	chain.pause();
+	TEST_ASSERT_FALSE_MESSAGE(done.isDone(), "A paused pass is not done");
+	sim.run(100);
+	TEST_ASSERT_FALSE_MESSAGE(done.isDone(), "Still paused");
+	TEST_ASSERT_EQUAL(0, paused);
+	chain.resume();
+	sim.run(100);
+	TEST_ASSERT_TRUE_MESSAGE(done.isDone(), "Done once resumed");
+	TEST_ASSERT_EQUAL_MESSAGE(1, paused, "Hook ran after the resumed pass");
+	TEST_ASSERT_EQUAL(6, log.times.size());
+
+	// Given to a pass that is over, the hook runs right away
+	done.then(countPass, &paused);
+	TEST_ASSERT_EQUAL_MESSAGE(2, paused, "Late hook runs at once");
+	TEST_ASSERT_EQUAL(3, passes);
+}
+
+void count(uint32_t arg) {}
+
+void simulate_a_day() {
+	EspEventSimulator sim;
+	EspEventRegistry::id_t id = EspEventRegistry::add("count", count);
+	std::vector<EspEventChain> chains(20);
+	for (size_t i = 0; i < chains.size(); i++) {
+		for (size_t j = 0; j < 50; j++) {
+			chains[i].emplace_back(10 + i + j, id);
+		}
+		chains[i].setCostOf(0, 100);
+		sim.add(chains[i]);
+		chains[i].start();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t events = sim.run(24UL * 3600 * 1000);
+	double seconds = std::chrono::duration<double>(
+						 std::chrono::steady_clock::now() - start)
+						 .count();
+
+	char msg[128];
+	snprintf(msg, sizeof(msg), "1 day, %u events in %.2f s, utilization %.4f",
+			 (unsigned)events, seconds, sim.getUtilization());
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_GREATER_THAN_MESSAGE(1000000, events, "Simulated a full day");
+}
+
+/* Worst lateness of a motor step chain sharing a dispatcher with four
+ * bookkeeping chains that come due at the same moments */
+uint32_t stepLateness(uint8_t chain_priority, uint8_t event_priority) {
+	EspEventSimulator sim;
+	Log log;
+	std::vector<EspEventChain> bookkeeping(
+		4, EspEventChain(EspEvent(10, record, &log)));
+	for (EspEventChain &chain : bookkeeping) {
+		chain.setCostOf(0, 2000);
+		sim.add(chain);
+		chain.start();
+	}
+
+	EspEventChain step(EspEvent(10, record, &log).setPriority(event_priority));
+	step.setPriority(chain_priority);
+	step.setCostOf(0, 200);
+	sim.add(step);
+	step.start();
+
+	sim.run(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(500, sim.getTotals().events, "Every event ran");
+	return sim.getReport(step).max_lateness_us;
+}
+
+void priority_under_load() {
+	const uint32_t fifo = stepLateness(0, 0);
+	const uint32_t chain = stepLateness(5, 0);
+	const uint32_t event = stepLateness(0, 5);
+
+	char msg[96];
+	snprintf(msg, sizeof(msg),
+			 "step lateness at 82%% load: %u us fifo, %u us prioritized",
+			 (unsigned)fifo, (unsigned)chain);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_EQUAL_MESSAGE(8000, fifo, "Waits behind bookkeeping");
+	TEST_ASSERT_EQUAL_MESSAGE(0, chain, "Chain priority runs first");
+	TEST_ASSERT_EQUAL_MESSAGE(0, event, "Event priority runs first");
+}
+
+/* A 50 ms flash write at the start holds up a sheddable telemetry chain and
+ * a control chain, each due every 5 ms */
+EspEventSimulator::report_t burst(unsigned long threshold_ms,
+								  uint32_t *telemetry_shed) {
+	EspEventSimulator sim;
+	Log log;
+	EspEventChain flash(EspEvent(1000, record, &log));
+	EspEventChain telemetry(EspEvent(5, record, &log).setSheddable(true));
+	EspEventChain control(EspEvent(5, record, &log));
+	flash.setCostOf(0, 50000);
+	telemetry.setCostOf(0, 2000);
+	control.setCostOf(0, 500);
+	control.setPriority(1);
+	sim.getDispatcher().setShedThreshold(threshold_ms);
+	for (EspEventChain *chain : {&flash, &telemetry, &control}) {
+		sim.add(*chain);
+		chain->start();
+	}
+
+	sim.run(1000);
+	*telemetry_shed = sim.getReport(telemetry).shed;
+	TEST_ASSERT_EQUAL_MESSAGE(*telemetry_shed, sim.getDispatcher().getShed(),
+							  "Dispatcher counts the same events");
+	TEST_ASSERT_EQUAL_MESSAGE(*telemetry_shed, telemetry.getShed(),
+							  "Chain counts the same events");
+	TEST_ASSERT_EQUAL_MESSAGE(0, flash.getShed() + control.getShed(),
+							  "Only sheddable events dropped");
+	return sim.getReport(control);
+}
+
+void shedding_after_burst() {
+	uint32_t kept_shed, shed;
+	const EspEventSimulator::report_t kept = burst(0, &kept_shed);
+	const EspEventSimulator::report_t shedding = burst(5, &shed);
+
+	char msg[128];
+	snprintf(msg, sizeof(msg),
+			 "control lateness: %llu us total running every event, "
+			 "%llu us shedding %u",
+			 (unsigned long long)kept.total_lateness_us,
+			 (unsigned long long)shedding.total_lateness_us, (unsigned)shed);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_EQUAL_MESSAGE(0, kept_shed, "Nothing shed by default");
+	TEST_ASSERT_TRUE_MESSAGE(shed > 0, "Late telemetry shed");
+	TEST_ASSERT_TRUE_MESSAGE(shed < 20, "Stops once caught up");
+	TEST_ASSERT_EQUAL_MESSAGE(kept.events, shedding.events,
+							  "Control events all run");
+	TEST_ASSERT_LESS_THAN_MESSAGE(kept.total_lateness_us,
+								  shedding.total_lateness_us,
+								  "Catches up sooner");
+}
+
+void nothing(EspEventContext &context) {}
+
+void raiseReady(EspEventContext &context) {
+	context.getPayload<EspEventDispatcher>()->raise("ready");
+}
+
+struct WaitLog {
+	std::vector<unsigned long> times;
+	std::vector<bool> timed_out;
+};
+
+void recordWait(EspEventContext &context) {
+	WaitLog *log = context.getPayload<WaitLog>();
+	log->times.push_back(context.getStartTime());
+	log->timed_out.push_back(context.isTimedOut());
+}
+
+void signal_wait() {
+	EspEventSimulator sim;
+	EspEventDispatcher &dispatcher = sim.getDispatcher();
+
+	// Raises "ready" at 30, 160, 290...
+	EspEventChain sensor(EspEvent(100, nothing),
+						 EspEvent(30, raiseReady, &dispatcher));
+
+	// Requests a reading, then waits for it with no timeout
+	WaitLog reader_log;
+	EspEventChain reader(EspEvent(50, recordWait, &reader_log),
+						 EspEvent(0, recordWait, &reader_log));
+	reader.setSignalOf(1, "ready");
+
+	// Waits for a signal that never comes, up to 100 ms
+	WaitLog timeout_log;
+	EspEventChain timeout(EspEvent(50, recordWait, &timeout_log),
+						  EspEvent(100, recordWait, &timeout_log));
+	timeout.setSignalOf(1, "never");
+
+	sim.add(sensor);
+	sim.add(reader);
+	sim.add(timeout);
+	sensor.start();
+	reader.start();
+	timeout.start();
+	sim.run(300);
+
+	const unsigned long reader_times[] = {0, 30, 80, 160, 210, 290};
+	TEST_ASSERT_EQUAL_MESSAGE(6, reader_log.times.size(), "Reader steps");
+	for (size_t i = 0; i < reader_log.times.size(); i++) {
+		TEST_ASSERT_EQUAL_MESSAGE(reader_times[i], reader_log.times[i],
+								  "Resumed as the signal is raised");
+		TEST_ASSERT_FALSE_MESSAGE(reader_log.timed_out[i], "Never timed out");
+	}
+
+	const unsigned long timeout_times[] = {0, 100, 150, 250};
+	TEST_ASSERT_EQUAL_MESSAGE(4, timeout_log.times.size(), "Timeout steps");
+	for (size_t i = 0; i < timeout_log.times.size(); i++) {
+		TEST_ASSERT_EQUAL_MESSAGE(timeout_times[i], timeout_log.times[i],
+								  "Runs at the timeout");
+		TEST_ASSERT_EQUAL_MESSAGE(i % 2 == 1, timeout_log.timed_out[i],
+								  "Only the wait times out");
+	}
+
+	// Only woken by signals, never polled
+	TEST_ASSERT_EQUAL_MESSAGE(6, sim.getReport(reader).events,
+							  "No wake-ups while waiting");
+	TEST_ASSERT_EQUAL_MESSAGE(0, dispatcher.raise("never"), "Nobody waits");
+}
+
+void advance_ends_wait() {
+	EspEventSimulator sim;
+	WaitLog log;
+	EspEventChain reader(EspEvent(50, recordWait, &log),
+						 EspEvent(0, recordWait, &log));
+	reader.setSignalOf(1, "ready");
+	sim.add(reader);
+	reader.start();
+	sim.run(100);
+	TEST_ASSERT_EQUAL_MESSAGE(1, log.times.size(), "Waiting");
+
+	// Stands in for the signal, which would never come
+	reader.advanceFromISR();
+	sim.run(100);
+	TEST_ASSERT_EQUAL_MESSAGE(3, log.times.size(), "Advanced");
+	TEST_ASSERT_EQUAL_MESSAGE(100, log.times[1], "Right away");
+	TEST_ASSERT_FALSE_MESSAGE(log.timed_out[1], "Not a timeout");
+	TEST_ASSERT_EQUAL_MESSAGE(150, log.times[2], "Then its delay");
+}
+
+void many_isr_requests() {
+	const size_t NUM_CHAINS = 3 * __ESP_EVENT_ISR_QUEUE_SIZE__;
+	EspEventSimulator sim;
+	Log log;
+	const EspEventChain pattern(EspEvent(10, record, &log));
+	std::vector<EspEventChain> chains(NUM_CHAINS, pattern);
+	for (EspEventChain &chain : chains) sim.add(chain);
+
+	// More chains than the queue holds, each asking several times
+	for (size_t i = 0; i < 3; i++) {
+		for (size_t pos = 0; pos < NUM_CHAINS; pos += 2) {
+			chains[pos].triggerFromISR(false);
+		}
+	}
+	sim.run(5);
+	TEST_ASSERT_EQUAL_MESSAGE(NUM_CHAINS / 2, log.times.size(),
+							  "Every request handled once");
+	for (size_t pos = 0; pos < NUM_CHAINS; pos++) {
+		TEST_ASSERT_EQUAL_MESSAGE(pos % 2 == 0, chains[pos].isRunning(),
+								  "Only the chains asked");
+	}
+
+	// Once drained, the queue takes requests again
+	log.times.clear();
+	chains[1].triggerFromISR(false);
+	sim.run(5);
+	TEST_ASSERT_EQUAL(1, log.times.size());
+	TEST_ASSERT_TRUE(chains[1].isRunning());
+}
+
+struct Worker {
+	EspEventSimulator *sim;
+	EspEventChain *chain;
+	unsigned long runs;
+};
+
+/* Takes 500 us more than declared on every other run */
+void slowEveryOther(EspEventContext &context) {
+	Worker *worker = context.getPayload<Worker>();
+	if (worker->runs++ % 2) worker->sim->spend(500);
+}
+
+void removeSelf(EspEventContext &context) {
+	Worker *worker = context.getPayload<Worker>();
+	worker->runs++;
+	worker->sim->remove(*worker->chain);
+}
+
+void overruns_and_removal() {
+	EspEventSimulator sim;
+	Worker worker = {&sim, nullptr, 0};
+	EspEventChain chain(EspEvent(10, slowEveryOther, &worker));
+	chain.setCostOf(0, 1000);
+	sim.add(chain);
+	chain.start();
+	sim.run(100);
+
+	TEST_ASSERT_EQUAL(10, worker.runs);
+	TEST_ASSERT_EQUAL_MESSAGE(5, chain.getOverruns(), "Spent past the cost");
+	TEST_ASSERT_EQUAL_MESSAGE(10 * 1000 + 5 * 500,
+							  sim.getReport(chain).busy_us,
+							  "Cost and extra time both count");
+
+	// Accounting skips a chain gone from the simulator
+	Worker leaving = {&sim, nullptr, 0};
+	EspEventChain leaver(EspEvent(10, removeSelf, &leaving));
+	leaving.chain = &leaver;
+	sim.add(leaver);
+	leaver.start();
+	sim.run(100);
+	TEST_ASSERT_EQUAL(1, leaving.runs);
+	TEST_ASSERT_FALSE(leaver.isRunning());
+	TEST_ASSERT_EQUAL_MESSAGE(20, worker.runs, "Others keep running");
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(event_timing);
+	RUN_TEST(costs_delay_other_chains);
+	RUN_TEST(dynamic_delay);
+	RUN_TEST(run_once_finishes);
+	RUN_TEST(run_once_pipeline);
+	RUN_TEST(run_once_completion);
+	RUN_TEST(simulate_a_day);
+	RUN_TEST(priority_under_load);
+	RUN_TEST(shedding_after_burst);
+	RUN_TEST(signal_wait);
+	RUN_TEST(advance_ends_wait);
+	RUN_TEST(many_isr_requests);
+	RUN_TEST(overruns_and_removal);
+	UNITY_END();
+	return 0;
+}
+
+#endif
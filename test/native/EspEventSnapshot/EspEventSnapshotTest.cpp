@@ -0,0 +1,124 @@
+#ifdef UNIT_TEST
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+#include "EspEventChain.h"
+#include "EspEventSimulator.h"
+#include "EspEventSnapshot.h"
+#include "unity.h"
+
+struct Fired {
+	unsigned long time;
+	size_t index;
+};
+
+void record(EspEventContext &context) {
+	context.getPayload<std::vector<Fired>>()->push_back(
+		{context.getStartTime(), context.getIndex()});
+}
+
+#define CHAIN(log)                                                             \
+	EspEvent(500, record, &log), EspEvent(200, record, &log),                  \
+		EspEvent(300, record, &log)
+
+void deep_sleep_round_trip() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+
+	// Run for a while, then record state and "sleep"
+	unsigned long sleep_ms;
+	{
+		EspEventChain chain(CHAIN(log));
+		EspEventChain paused(CHAIN(log));
+		sim.add(chain);
+		sim.add(paused);
+		chain.start();
+		paused.start();
+		sim.run(2100);
+		paused.pause();
+
+		EspEventSnapshot snapshot;
+		TEST_ASSERT_TRUE_MESSAGE(snapshot.capture(7, chain), "Captured");
+		TEST_ASSERT_TRUE_MESSAGE(snapshot.capture(8, paused), "Captured");
+		TEST_ASSERT_TRUE_MESSAGE(snapshot.save(), "Saved");
+		TEST_ASSERT_EQUAL_MESSAGE(8 + 2 * 16, snapshot.size(), "Compact");
+		sleep_ms = snapshot.getSleepDuration();
+		TEST_ASSERT_EQUAL_MESSAGE(100, sleep_ms, "Sleep until next deadline");
+		TEST_ASSERT_EQUAL_MESSAGE(2, chain.getCycles(), "Cycles");
+	}
+	sim.run(sleep_ms + 20);
+
+	// Rebuild after waking and restore
+	log.clear();
+	EspEventChain chain(CHAIN(log));
+	EspEventChain paused(CHAIN(log));
+	sim.add(chain);
+	sim.add(paused);
+	EspEventSnapshot snapshot;
+	TEST_ASSERT_TRUE_MESSAGE(snapshot.load(), "Loaded");
+	TEST_ASSERT_FALSE_MESSAGE(snapshot.restore(9, chain), "Unknown id");
+	TEST_ASSERT_TRUE_MESSAGE(snapshot.restore(7, chain), "Restored");
+	TEST_ASSERT_TRUE_MESSAGE(snapshot.restore(8, paused), "Restored");
+	TEST_ASSERT_EQUAL_MESSAGE(2, chain.getCycles(), "Cycles kept");
+	TEST_ASSERT_TRUE_MESSAGE(chain.isRunning(), "Running");
+	TEST_ASSERT_TRUE_MESSAGE(paused.isPaused(), "Still paused");
+	TEST_ASSERT_EQUAL_MESSAGE(100, paused.getTimeUntilNextEvent(),
+							  "Paused time left");
+
+	sim.run(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(3, log.size(), "Events after waking");
+	TEST_ASSERT_EQUAL_MESSAGE(1, log[0].index, "Overdue event first");
+	TEST_ASSERT_EQUAL_MESSAGE(2220, log[0].time, "Run at once");
+	TEST_ASSERT_EQUAL_MESSAGE(2, log[1].index, "Following event");
+	TEST_ASSERT_EQUAL_MESSAGE(2520, log[1].time, "Delay after overdue event");
+}
+
+void rejects_bad_snapshot() {
+	EspEventSimulator sim;
+	std::vector<Fired> log;
+	EspEventSnapshot snapshot;
+	EspEventChain small(EspEvent(100, record, &log));
+	EspEventChain chain(EspEvent(100, record, &log),
+						EspEvent(100, record, &log));
+	sim.add(chain);
+	chain.start();
+	sim.run(50);
+	chain.stop();
+	snapshot.capture(1, chain);
+	TEST_ASSERT_FALSE_MESSAGE(snapshot.restore(1, small), "Index too large");
+
+	for (uint16_t id = 0; id < __ESP_EVENT_SNAPSHOT_SIZE__ - 1; id++) {
+		TEST_ASSERT_TRUE_MESSAGE(snapshot.capture(100 + id, chain), "Room");
+	}
+	TEST_ASSERT_FALSE_MESSAGE(snapshot.capture(500, chain), "Full");
+	TEST_ASSERT_TRUE_MESSAGE(snapshot.capture(1, chain), "Replaced");
+	TEST_ASSERT_EQUAL_MESSAGE((unsigned long)-1, snapshot.getSleepDuration(),
+							  "No running chain");
+
+	// Timing of a full save / load / restore
+	const int N = 100000;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < N; i++) {
+		snapshot.save();
+		snapshot.load();
+		snapshot.restore(1, chain);
+	}
+	double ns = std::chrono::duration<double, std::nano>(
+					std::chrono::steady_clock::now() - start)
+					.count() /
+				N;
+	char msg[64];
+	snprintf(msg, sizeof(msg), "save + load + restore: %.0f ns", ns);
+	TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(deep_sleep_round_trip);
+	RUN_TEST(rejects_bad_snapshot);
+	UNITY_END();
+	return 0;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifdef UNIT_TEST
+
+#include <stdio.h>
+#include "EspEventChain.h"
+#include "EspEventTable.h"
+#include "unity.h"
+
+uint32_t led_state = 0;
+uint32_t beeps = 0;
+
+void setLed(uint32_t arg) { led_state = arg; }
+void beep(uint32_t arg) { beeps += arg; }
+
+EspEventRegistry::id_t LED = EspEventRegistry::add("led", setLed);
+EspEventRegistry::id_t BEEP = EspEventRegistry::add("beep", beep);
+
+EspEventChain makeChain() {
+	EspEventChain chain;
+	chain.emplace_back(100, LED, 1, "on");
+	chain.emplace_back(50, LED, 0, "off");
+	chain.emplace_back(0, BEEP, 3);
+	chain.push_back(EspEvent());
+	return chain;
+}
+
+void registry() {
+	TEST_ASSERT_EQUAL_MESSAGE(LED, EspEventRegistry::find("led"),
+							  "find() returns the id given by add()");
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventRegistry::INVALID_ID,
+							  EspEventRegistry::find("missing"),
+							  "find() on unknown name");
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("beep", EspEventRegistry::getName(BEEP),
+									 "getName()");
+
+	EspEvent e(10, LED, 7);
+	TEST_ASSERT_TRUE_MESSAGE(e, "Registry event is callable");
+	e.runEvent();
+	TEST_ASSERT_EQUAL_MESSAGE(7, led_state, "runEvent() passes the arg");
+}
+
+void round_trip() {
+	EspEventChain chain = makeChain();
+
+	const size_t size = EspEventTable::serializedSize(chain);
+	TEST_ASSERT_GREATER_THAN_MESSAGE(0, size, "Chain is serializable");
+
+	std::vector<uint8_t> buf(size);
+	TEST_ASSERT_EQUAL_MESSAGE(size, EspEventTable::write(chain, buf.data(), size),
+							  "write() fills serializedSize() bytes");
+	TEST_ASSERT_EQUAL_MESSAGE(
+		0, EspEventTable::write(chain, buf.data(), size - 1),
+		"write() refuses a short buffer");
+
+	EspEventTable table;
+	TEST_ASSERT_TRUE_MESSAGE(table.load(buf.data(), buf.size()), "load()");
+	EspEventChain loaded(table);
+
+	TEST_ASSERT_EQUAL_MESSAGE(chain.numEvents(), loaded.numEvents(),
+							  "numEvents() after round trip");
+	TEST_ASSERT_EQUAL_MESSAGE(chain.getTotalTime(), loaded.getTotalTime(),
+							  "getTotalTime() after round trip");
+	for (size_t pos = 0; pos < chain.numEvents(); pos++) {
+		EspEvent a = chain.getEvent(pos), b = loaded.getEvent(pos);
+		TEST_ASSERT_EQUAL_MESSAGE(a.getTime(), b.getTime(), "getTime()");
+		TEST_ASSERT_EQUAL_MESSAGE(a.getCallbackId(), b.getCallbackId(),
+								  "getCallbackId()");
+		TEST_ASSERT_EQUAL_MESSAGE(a.getArg(), b.getArg(), "getArg()");
+		TEST_ASSERT_EQUAL_STRING_MESSAGE(a.getHandle(), b.getHandle(),
+										 "getHandle()");
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(1, loaded.getPositionFromHandle("off"),
+							  "getPositionFromHandle() on table");
+
+	beeps = 0;
+	loaded.getEvent(2).runEvent();
+	TEST_ASSERT_EQUAL_MESSAGE(3, beeps, "Table events run their callback");
+}
+
+void rejects_bad_tables() {
+	EspEventChain chain = makeChain();
+	std::vector<uint8_t> buf(EspEventTable::serializedSize(chain));
+	EspEventTable::write(chain, buf.data(), buf.size());
+
+	EspEventTable table;
+	TEST_ASSERT_FALSE_MESSAGE(table.load(buf.data(), buf.size() - 1),
+							  "Truncated table");
+
+	std::vector<uint8_t> bad = buf;
+	bad[0] ^= 0xFF;
+	TEST_ASSERT_FALSE_MESSAGE(table.load(bad.data(), bad.size()), "Bad magic");
+
+	// The last string of the pool loses its terminator
+	bad = buf;
+	bad.back() = 'x';
+	TEST_ASSERT_FALSE_MESSAGE(table.load(bad.data(), bad.size()),
+							  "Unterminated handle");
+
+	EspEventChain named(EspEvent(10, LED, 1));
+	bad.assign(EspEventTable::serializedSize(named), 0);
+	EspEventTable::write(named, bad.data(), bad.size());
+	bad.back() = 'x';
+	TEST_ASSERT_FALSE_MESSAGE(table.load(bad.data(), bad.size()),
+							  "Unterminated name");
+
+	EspEventRegistry::id_t id = EspEventRegistry::add(
+		"a_callback_name_longer_than_the_limit", beep);
+	EspEventChain long_name(EspEvent(10, id, 1));
+	TEST_ASSERT_EQUAL_MESSAGE(0, EspEventTable::serializedSize(long_name),
+							  "Name too long to load");
+
+	EspEventChain lambda_chain(EspEvent(10, []() {}));
+	TEST_ASSERT_EQUAL_MESSAGE(0, EspEventTable::serializedSize(lambda_chain),
+							  "Lambda events cannot be serialized");
+}
+
+void modify_copies_table() {
+	EspEventChain chain = makeChain();
+	std::vector<uint8_t> buf(EspEventTable::serializedSize(chain));
+	EspEventTable::write(chain, buf.data(), buf.size());
+
+	EspEventTable table;
+	table.load(buf.data(), buf.size());
+	EspEventChain loaded(table);
+	loaded.changeTimeOf(0, 1234);
+
+	TEST_ASSERT_EQUAL_MESSAGE(1234, loaded.getTimeOf(0),
+							  "changeTimeOf() on a table chain");
+	TEST_ASSERT_EQUAL_MESSAGE(50, loaded.getTimeOf(1),
+							  "Other events kept after copy");
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("on", loaded.getEvent(0).getHandle(),
+									 "Handles kept after copy");
+}
+
+void mapped_file() {
+	EspEventChain chain = makeChain();
+	std::vector<uint8_t> buf(EspEventTable::serializedSize(chain));
+	EspEventTable::write(chain, buf.data(), buf.size());
+
+	const char *path = "EspEventTableTest.bin";
+	FILE *f = fopen(path, "wb");
+	TEST_ASSERT_NOT_NULL_MESSAGE(f, "Open temp file");
+	fwrite(buf.data(), 1, buf.size(), f);
+	fclose(f);
+
+	EspEventTableFile file;
+	TEST_ASSERT_TRUE_MESSAGE(file.open(path), "mmap table file");
+
+	EspEventTable table;
+	TEST_ASSERT_TRUE_MESSAGE(table.load(file.data(), file.size()),
+							 "load() from mapped file");
+	EspEventChain loaded(table);
+	TEST_ASSERT_EQUAL_MESSAGE(chain.getTotalTime(), loaded.getTotalTime(),
+							  "getTotalTime() from mapped file");
+
+	file.close();
+	remove(path);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(registry);
+	RUN_TEST(round_trip);
+	RUN_TEST(rejects_bad_tables);
+	RUN_TEST(modify_copies_table);
+	RUN_TEST(mapped_file);
+	UNITY_END();
+	return 0;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifdef UNIT_TEST
+
+#include <algorithm>
+#include <tuple>
+#include "EspEventChain.h"
+#include "EspEventSimulator.h"
+#include "EspEventTimeline.h"
+#include "unity.h"
+
+typedef std::tuple<unsigned long, const EspEventChain *, size_t> fired_t;
+typedef std::vector<fired_t> log_t;
+
+void record(EspEventContext &context) {
+	context.getPayload<log_t>()->push_back(fired_t(
+		context.getScheduledTime(), context.getChain(), context.getIndex()));
+}
+
+/* Cycles of 100, 150 and 75 ms, the last skipping an event without callback */
+struct Chains {
+	log_t log;
+	EspEventChain a, b, c;
+	Chains()
+		: a(EspEvent(100, record, &log)),
+		  b(EspEvent(40, record, &log), EspEvent(60, record, &log),
+			EspEvent(50, record, &log)),
+		  c(EspEvent(25, record, &log), EspEvent(),
+			EspEvent(50, record, &log)) {}
+};
+
+void compiles_hyperperiod() {
+	Chains chains;
+	EspEventTimeline timeline;
+	TEST_ASSERT_TRUE_MESSAGE(
+		timeline.compile({&chains.a, &chains.b, &chains.c}), "Compiled");
+	TEST_ASSERT_EQUAL_MESSAGE(300, timeline.getHyperperiod(), "LCM of cycles");
+	TEST_ASSERT_EQUAL_MESSAGE(3 + 6 + 8, timeline.numSteps(), "Unrolled events");
+	TEST_ASSERT_EQUAL_MESSAGE(300, timeline.getChain().getTotalTime(),
+							  "Merged chain spans the hyperperiod");
+	TEST_ASSERT_EQUAL_MESSAGE(&chains.b, timeline.getStep(1).chain,
+							  "Ties in chain order");
+	TEST_ASSERT_EQUAL_MESSAGE(0, timeline.getStep(1).offset, "Offset");
+
+	TEST_ASSERT_FALSE_MESSAGE(
+		timeline.compile({&chains.a, &chains.b}, 200), "Bounded hyperperiod");
+	TEST_ASSERT_EQUAL_MESSAGE(0, timeline.numSteps(), "Empty after failure");
+}
+
+void matches_separate_chains() {
+	const unsigned long DURATION_MS = 1000;
+
+	// Run each chain on its own
+	Chains separate;
+	{
+		EspEventSimulator sim;
+		sim.add(separate.a);
+		sim.add(separate.b);
+		sim.add(separate.c);
+		separate.a.start();
+		separate.b.start();
+		separate.c.start();
+		sim.run(DURATION_MS);
+	}
+
+	// Run the same chains merged into one
+	Chains merged;
+	EspEventTimeline timeline;
+	timeline.compile({&merged.a, &merged.b, &merged.c});
+	{
+		EspEventSimulator sim;
+		sim.add(timeline.getChain());
+		timeline.getChain().start();
+		sim.run(DURATION_MS);
+		sim.remove(timeline.getChain());
+	}
+
+	// Only the order of events due at the same time may differ
+	TEST_ASSERT_EQUAL_MESSAGE(separate.log.size(), merged.log.size(),
+							  "Same number of events");
+	for (size_t i = 0; i < merged.log.size(); i++) {
+		fired_t expected = separate.log[i];
+		fired_t actual = merged.log[i];
+		TEST_ASSERT_EQUAL_MESSAGE(std::get<0>(expected), std::get<0>(actual),
+								  "Same time");
+	}
+	std::stable_sort(separate.log.begin(), separate.log.end(),
+					 [&](const fired_t &x, const fired_t &y) {
+						 return std::get<0>(x) < std::get<0>(y);
+					 });
+	for (size_t i = 0; i < merged.log.size(); i++) {
+		const EspEventChain *expected = std::get<1>(separate.log[i]);
+		const EspEventChain *actual = std::get<1>(merged.log[i]);
+		const size_t chain = expected == &separate.a ? 0
+							 : expected == &separate.b ? 1 : 2;
+		const size_t merged_chain = actual == &merged.a ? 0
+									: actual == &merged.b ? 1 : 2;
+		TEST_ASSERT_EQUAL_MESSAGE(chain, merged_chain, "Same chain");
+		TEST_ASSERT_EQUAL_MESSAGE(std::get<2>(separate.log[i]),
+								  std::get<2>(merged.log[i]), "Same event");
+	}
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(compiles_hyperperiod);
+	RUN_TEST(matches_separate_chains);
+	UNITY_END();
+	return 0;
+}
+
+#endif
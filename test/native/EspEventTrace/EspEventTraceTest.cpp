@@ -0,0 +1,113 @@
+#ifdef UNIT_TEST
+
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include "EspEventChain.h"
+#include "EspEventSimulator.h"
+#include "EspEventTrace.h"
+#include "unity.h"
+
+void nothing(EspEventContext &context) {}
+
+void records_dispatched_events() {
+	EspEventSimulator sim;
+	EspEventTrace trace;
+	sim.getDispatcher().setTrace(&trace);
+
+	EspEventChain fast(EspEvent(10, nothing), EspEvent(20, nothing));
+	EspEventChain slow(EspEvent(100, nothing));
+	fast.setId(1);
+	slow.setId(2);
+	fast.setCostOf(1, 15000);
+	sim.add(fast);
+	sim.add(slow);
+	fast.start();
+	slow.start();
+	sim.run(100);
+
+#if __ESP_EVENT_TRACE__
+	// fast at 0, 20, 35, 50, 65, 80, 95, slow at 0
+	TEST_ASSERT_EQUAL_MESSAGE(8, trace.size(), "Every event recorded");
+	TEST_ASSERT_EQUAL_MESSAGE(1, trace.get(0).chain_id, "First chain");
+	TEST_ASSERT_EQUAL_MESSAGE(2, trace.get(1).chain_id, "Second chain");
+	TEST_ASSERT_EQUAL_MESSAGE(20, trace.get(2).scheduled_ms, "Deadline");
+	TEST_ASSERT_EQUAL_MESSAGE(1, trace.get(2).index, "Event index");
+	TEST_ASSERT_EQUAL_MESSAGE(20000, trace.get(2).start_us, "Start time");
+
+	// The simulator adds declared costs after the event returns, so the
+	// cost shows as lateness of the next event
+	TEST_ASSERT_EQUAL_MESSAGE(35000, trace.get(3).start_us, "Ran late");
+	TEST_ASSERT_EQUAL_MESSAGE(30, trace.get(3).scheduled_ms, "Deadline kept");
+#else
+	TEST_ASSERT_EQUAL_MESSAGE(0, trace.size(), "Compiled out");
+#endif
+}
+
+void wraps_and_converts() {
+	EspEventTrace trace;
+	const size_t total = EspEventTrace::SIZE + 10;
+	for (size_t i = 0; i < total; i++) {
+		// Start times wrap around 32 bits part way through
+		const uint32_t start = 0xFFFFFF00u + i * 10;
+		trace.record({(uint32_t)i, start, start + 3, 7, (uint16_t)i});
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventTrace::SIZE, trace.size(), "Full");
+	TEST_ASSERT_EQUAL_MESSAGE(10, trace.getDropped(), "Oldest overwritten");
+	TEST_ASSERT_EQUAL_MESSAGE(10, trace.get(0).scheduled_ms, "Oldest first");
+
+	uint8_t buffer[sizeof(EspEventTraceHeader) +
+				   sizeof(EspEventTraceRecord) * EspEventTrace::SIZE];
+	const size_t len = trace.dump(buffer, sizeof(buffer));
+	TEST_ASSERT_EQUAL_MESSAGE(sizeof(buffer), len, "Dump size");
+	TEST_ASSERT_EQUAL_MESSAGE(len, trace.dump(nullptr, 0), "Size query");
+
+	EspEventTrace host;
+	TEST_ASSERT_TRUE_MESSAGE(host.load(buffer, len), "Loaded");
+	TEST_ASSERT_EQUAL_MESSAGE(10, host.getDropped(), "Dropped kept");
+	TEST_ASSERT_EQUAL_MESSAGE(total - 1,
+							  host.get(EspEventTrace::SIZE - 1).scheduled_ms,
+							  "Newest last");
+	buffer[0] ^= 0xFF;
+	TEST_ASSERT_FALSE_MESSAGE(host.load(buffer, len), "Bad magic");
+	TEST_ASSERT_EQUAL_MESSAGE(0, host.size(), "Emptied");
+
+	const std::string json = trace.toChromeJson();
+	TEST_ASSERT_TRUE_MESSAGE(json.find("{\"traceEvents\":[{") == 0, "Header");
+	char last[64];
+	snprintf(last, sizeof(last), "\"ts\":%llu,\"dur\":3,",
+			 0xFFFFFF00ull + (total - 1) * 10);
+	TEST_ASSERT_TRUE_MESSAGE(json.find(last) != std::string::npos,
+							 "Timestamps unwrapped");
+}
+
+void record_cost() {
+	EspEventTrace trace;
+	const size_t N = 1000000;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < N; i++) {
+		const uint32_t now = EspEventClock::nowMicros();
+		trace.record({(uint32_t)i, now, now, 1, (uint16_t)i});
+	}
+	const double record_ns = std::chrono::duration<double, std::nano>(
+								 std::chrono::steady_clock::now() - start)
+								 .count() /
+							 N;
+
+	char msg[64];
+	snprintf(msg, sizeof(msg), "%.1f ns per record with clock read",
+			 record_ns);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_EQUAL_MESSAGE(EspEventTrace::SIZE, trace.size(), "Full");
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(records_dispatched_events);
+	RUN_TEST(wraps_and_converts);
+	RUN_TEST(record_cost);
+	UNITY_END();
+	return 0;
+}
+
+#endif
@@ -82,10 +82,16 @@ void run_once() {
 	EspEvent e2(20, [&]() { count++; });
 	EspEventChain chain(e1, e1, e1, e2, e2);
 
-	chain.runOnce();
-	delay(chain.getTotalTime() * 3);
+	// Waits only as long as the pass takes, bounded in case it never ends
+	const EspEventCompletion done = chain.runOnce();
+	const unsigned long start = millis();
+	while (!done.isDone() && millis() - start < chain.getTotalTime() * 3) {
+		delay(1);
+	}
 	chain.stop();
 
+	TEST_ASSERT_TRUE_MESSAGE(done.isDone(), "Pass completed");
+	TEST_ASSERT_EQUAL_MESSAGE(1, chain.getCompletions(), "Counted once");
 	TEST_ASSERT_EQUAL_MESSAGE(chain.numEvents(), count,
 							  "Correct number of ticks");
 }